@@ -0,0 +1,251 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "AllocationAccounting.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <new>
+
+#include <fmt/format.h>
+
+#include "Misc.h"
+
+namespace {
+   constexpr std::size_t kThreadSlots {256}; /* later threads share the last slot */
+
+   /* Fixed storage, so counting an allocation never allocates */
+   struct ThreadSlot {
+      std::atomic<std::uint64_t> allocations {0};
+      std::atomic<gsl::czstring<>> name {nullptr};
+   };
+
+   std::array<ThreadSlot, kThreadSlots> thread_slots {};
+   std::atomic<std::size_t> slots_used {0};
+   thread_local std::uint64_t t_allocations {0};
+   thread_local ThreadSlot* t_slot {nullptr};
+
+   ThreadSlot& ThisThreadSlot() noexcept
+   {
+      if (!t_slot) {
+         const auto index {slots_used.fetch_add(1, std::memory_order_relaxed)};
+         t_slot = &thread_slots.at(std::min(index, kThreadSlots - 1));
+      }
+      return *t_slot;
+   }
+
+   struct SiteRegistry {
+      std::mutex mutex;
+      std::vector<rsj::AllocationSite*> sites {};
+   };
+
+   /* sites are function-local statics, so they outlive any report */
+   SiteRegistry& Sites()
+   {
+      static SiteRegistry registry {};
+      return registry;
+   }
+
+#ifdef MIDI2LR_ALLOC_ACCOUNTING
+   void CountAllocation() noexcept
+   {
+      ++t_allocations;
+      ThisThreadSlot().allocations.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void* CountedAllocate(std::size_t size)
+   {
+      CountAllocation();
+      if (const auto p {std::malloc(size ? size : 1)})
+         return p;
+      throw std::bad_alloc();
+   }
+#endif
+} // namespace
+
+#ifdef MIDI2LR_ALLOC_ACCOUNTING
+/* Aligned forms are left to the library: nothing on the measured paths uses them */
+void* operator new(std::size_t size) { return CountedAllocate(size); }
+void* operator new[](std::size_t size) { return CountedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+   CountAllocation();
+   return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+   CountAllocation();
+   return std::malloc(size ? size : 1);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
+
+std::uint64_t rsj::ThreadAllocations() noexcept { return t_allocations; }
+
+rsj::AllocationSite::AllocationSite(const gsl::czstring<> label) : label_ {label}
+{
+   try {
+      auto& registry {Sites()};
+      const std::scoped_lock lock {registry.mutex};
+      registry.sites.push_back(this);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+rsj::AllocationScope::AllocationScope(AllocationSite& site) noexcept
+    : site_ {site}, start_ {t_allocations}
+{
+   auto& slot {ThisThreadSlot()};
+   if (!slot.name.load(std::memory_order_relaxed))
+      slot.name.store(site.Label(), std::memory_order_relaxed);
+}
+
+rsj::AllocationScope::~AllocationScope() { site_.Record(t_allocations - start_); }
+
+std::vector<rsj::AllocationTotals> rsj::ScopeAllocations()
+{
+   try {
+      std::map<std::string, AllocationTotals> by_label {};
+      {
+         auto& registry {Sites()};
+         const std::scoped_lock lock {registry.mutex};
+         for (const auto* site : registry.sites) {
+            auto& totals {by_label[site->Label()]};
+            totals.entries += site->Entries();
+            totals.allocations += site->Allocations();
+         }
+      }
+      std::vector<AllocationTotals> result {};
+      result.reserve(by_label.size());
+      for (auto& [label, totals] : by_label) {
+         totals.label = label;
+         result.push_back(std::move(totals));
+      }
+      return result;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+std::vector<rsj::AllocationTotals> rsj::ThreadAllocationTotals()
+{
+   try {
+      std::vector<AllocationTotals> result {};
+      const auto used {std::min(slots_used.load(std::memory_order_relaxed), kThreadSlots)};
+      for (std::size_t i {0}; i < used; ++i) {
+         const auto& slot {thread_slots.at(i)};
+         const auto name {slot.name.load(std::memory_order_relaxed)};
+         result.push_back({name ? fmt::format(FMT_STRING("thread {} ({})"), i, name)
+                                : fmt::format(FMT_STRING("thread {}"), i),
+             0, slot.allocations.load(std::memory_order_relaxed)});
+      }
+      return result;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+void rsj::ResetAllocationCounts() noexcept
+{
+   try {
+      for (auto& slot : thread_slots) slot.allocations.store(0, std::memory_order_relaxed);
+      auto& registry {Sites()};
+      const std::scoped_lock lock {registry.mutex};
+      for (auto* site : registry.sites) site->Reset();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+   }
+}
+
+std::vector<std::string> rsj::AllocationReport()
+{
+   try {
+      std::vector<std::string> lines {};
+      if constexpr (!kAllocAccounting) {
+         lines.emplace_back("Allocations: not counted in this build.");
+         return lines;
+      }
+      for (const auto& scope : ScopeAllocations())
+         lines.push_back(
+             fmt::format(FMT_STRING("Allocations in {}: {} in {} entries, {:.3f} per entry."),
+                 scope.label, scope.allocations, scope.entries,
+                 scope.entries ? static_cast<double>(scope.allocations)
+                                     / static_cast<double>(scope.entries)
+                               : 0.0));
+      for (const auto& thread : ThreadAllocationTotals())
+         lines.push_back(fmt::format(
+             FMT_STRING("Allocations on {}: {}."), thread.label, thread.allocations));
+      return lines;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+bool rsj::CheckAllocationFree(const gsl::span<const gsl::czstring<>> labels)
+{
+   try {
+      if constexpr (!kAllocAccounting) {
+         rsj::Log("Allocation check failed: build doesn't define MIDI2LR_ALLOC_ACCOUNTING.");
+         return false;
+      }
+      const auto scopes {ScopeAllocations()};
+      auto passed {true};
+      for (const auto label : labels) {
+         const auto found {std::find_if(scopes.begin(), scopes.end(),
+             [label](const AllocationTotals& totals) { return totals.label == label; })};
+         if (found == scopes.end() || found->entries == 0) {
+            rsj::Log(fmt::format(FMT_STRING("Allocation check: {} was never entered."), label));
+            passed = false;
+         }
+         else if (found->allocations) {
+            rsj::Log(fmt::format(
+                FMT_STRING("Allocation check: {} made {} allocations in {} entries, {:.3f} per "
+                           "entry."),
+                label, found->allocations, found->entries,
+                static_cast<double>(found->allocations) / static_cast<double>(found->entries)));
+            passed = false;
+         }
+         else
+            rsj::Log(fmt::format(FMT_STRING("Allocation check: {} made no allocations in {} "
+                                            "entries."),
+                label, found->entries));
+      }
+      rsj::Log(passed ? "Allocation check passed." : "Allocation check failed.");
+      return passed;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
@@ -0,0 +1,119 @@
+#ifndef MIDI2LR_ALLOCATIONACCOUNTING_H_INCLUDED
+#define MIDI2LR_ALLOCATIONACCOUNTING_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gsl/gsl>
+
+/* Opt-in heap allocation accounting. Builds that define MIDI2LR_ALLOC_ACCOUNTING replace the
+ * global operator new to count allocations per thread, and MIDI2LR_ALLOC_SCOPE("label") counts the
+ * allocations the calling thread makes until the end of the enclosing block. In other builds the
+ * scopes compile to nothing and all counts are zero. */
+namespace rsj {
+#ifdef MIDI2LR_ALLOC_ACCOUNTING
+   inline constexpr bool kAllocAccounting {true};
+#else
+   inline constexpr bool kAllocAccounting {false};
+#endif
+
+   /* allocations made by the calling thread since it started */
+   [[nodiscard]] std::uint64_t ThreadAllocations() noexcept;
+
+   /* One per MIDI2LR_ALLOC_SCOPE. Sites sharing a label are reported together */
+   class AllocationSite {
+    public:
+      /* label must be a string literal: it is kept, not copied */
+      explicit AllocationSite(gsl::czstring<> label);
+      ~AllocationSite() = default;
+      AllocationSite(const AllocationSite& other) = delete;
+      AllocationSite(AllocationSite&& other) = delete;
+      AllocationSite& operator=(const AllocationSite& other) = delete;
+      AllocationSite& operator=(AllocationSite&& other) = delete;
+      [[nodiscard]] gsl::czstring<> Label() const noexcept { return label_; }
+      [[nodiscard]] std::uint64_t Entries() const noexcept
+      {
+         return entries_.load(std::memory_order_relaxed);
+      }
+      [[nodiscard]] std::uint64_t Allocations() const noexcept
+      {
+         return allocations_.load(std::memory_order_relaxed);
+      }
+      void Record(std::uint64_t allocations) noexcept
+      {
+         entries_.fetch_add(1, std::memory_order_relaxed);
+         allocations_.fetch_add(allocations, std::memory_order_relaxed);
+      }
+      void Reset() noexcept
+      {
+         entries_.store(0, std::memory_order_relaxed);
+         allocations_.store(0, std::memory_order_relaxed);
+      }
+
+    private:
+      gsl::czstring<> label_;
+      std::atomic<std::uint64_t> entries_ {0};
+      std::atomic<std::uint64_t> allocations_ {0};
+   };
+
+   class AllocationScope {
+    public:
+      explicit AllocationScope(AllocationSite& site) noexcept;
+      ~AllocationScope();
+      AllocationScope(const AllocationScope& other) = delete;
+      AllocationScope(AllocationScope&& other) = delete;
+      AllocationScope& operator=(const AllocationScope& other) = delete;
+      AllocationScope& operator=(AllocationScope&& other) = delete;
+
+    private:
+      AllocationSite& site_;
+      std::uint64_t start_;
+   };
+
+   struct AllocationTotals {
+      std::string label;             /* scope label or thread name */
+      std::uint64_t entries {0};     /* times the scope was entered; 0 for threads */
+      std::uint64_t allocations {0}; /* since the last reset */
+   };
+
+   /* per label, in label order */
+   [[nodiscard]] std::vector<AllocationTotals> ScopeAllocations();
+   /* per thread. A thread is named after the first scope it enters */
+   [[nodiscard]] std::vector<AllocationTotals> ThreadAllocationTotals();
+   void ResetAllocationCounts() noexcept;
+   [[nodiscard]] std::vector<std::string> AllocationReport();
+   /* Logs allocations per entry for each label, and returns true only if every label was entered
+    * and none allocated. Reset first to measure a steady state */
+   [[nodiscard]] bool CheckAllocationFree(gsl::span<const gsl::czstring<>> labels);
+} // namespace rsj
+
+#ifdef MIDI2LR_ALLOC_ACCOUNTING
+#define MIDI2LR_ALLOC_CONCAT2(a, b) a##b
+#define MIDI2LR_ALLOC_CONCAT(a, b) MIDI2LR_ALLOC_CONCAT2(a, b)
+#define MIDI2LR_ALLOC_SCOPE(label)                                                                \
+   static rsj::AllocationSite MIDI2LR_ALLOC_CONCAT(alloc_site_, __LINE__) {label};               \
+   const rsj::AllocationScope MIDI2LR_ALLOC_CONCAT(alloc_scope_, __LINE__)                       \
+   {                                                                                               \
+      MIDI2LR_ALLOC_CONCAT(alloc_site_, __LINE__)                                                  \
+   }
+#else
+#define MIDI2LR_ALLOC_SCOPE(label) static_cast<void>(0)
+#endif
+
+#endif
@@ -0,0 +1,336 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "AsyncLogger.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include <juce_core/juce_core.h>
+
+#include "Misc.h"
+
+namespace {
+   constexpr std::size_t kRingSize {1024};   /* power of 2 */
+   constexpr std::size_t kSiteCount {512};   /* power of 2 */
+   constexpr std::size_t kPayloadSize {472}; /* keeps a record at 512 bytes on 64-bit */
+   constexpr std::size_t kSiteTextPrefix {32};
+   constexpr auto kWriterPeriod {std::chrono::milliseconds(25)};
+
+   struct LogRecord {
+      std::int64_t time_ms {0};
+      gsl::czstring<> file {nullptr};
+      std::uint_least32_t line {0};
+      std::uint32_t suppressed {0};
+      std::size_t length {0};
+      std::array<char, kPayloadSize> payload {};
+   };
+
+   struct RingCell {
+      std::atomic<std::size_t> sequence {0};
+      LogRecord record {};
+   };
+
+   /* sites that hash to the same slot share a budget, which only makes the limit stricter */
+   struct SiteBudget {
+      std::atomic<std::int64_t> second {0};
+      std::atomic<std::int32_t> count {0};
+      std::atomic<std::uint32_t> suppressed {0};
+   };
+
+   [[nodiscard]] std::size_t SiteHash(
+       gsl::czstring<> file, std::uint_least32_t line, std::string_view text) noexcept
+   {
+      if (file)
+         return std::hash<const void*> {}(file) ^ (std::size_t {line} * 0x9E3779B9U);
+      return std::hash<std::string_view> {}(text.substr(0, kSiteTextPrefix));
+   }
+
+   [[nodiscard]] juce::String FormatRecord(const LogRecord& record)
+   {
+      auto text {juce::Time(record.time_ms).toISO8601(true)};
+      if (record.file)
+         text << ":" << record.file << ":" << juce::String(record.line) << " ";
+      else
+         text << ": ";
+      text << juce::String::fromUTF8(record.payload.data(), gsl::narrow_cast<int>(record.length));
+      if (record.suppressed)
+         text << " [" << juce::String(record.suppressed) << " more from here suppressed]";
+      return text;
+   }
+
+   void WriteRecord(gsl::czstring<> file, std::uint_least32_t line, std::string_view text)
+   {
+      if (juce::Logger::getCurrentLogger()) {
+         LogRecord record {juce::Time::currentTimeMillis(), file, line};
+         record.length = std::min(text.size(), kPayloadSize);
+         text.copy(record.payload.data(), record.length);
+         juce::Logger::writeToLog(FormatRecord(record));
+      }
+   }
+
+   /* Bounded multi-producer single-consumer ring after Vyukov's array queue: a producer claims a
+    * cell by advancing enqueue_pos_, fills it, then publishes it through the cell's sequence. A
+    * full ring drops the record rather than making the caller wait. The consumer is usually the
+    * writer thread; drain_mutex_ lets error reports and flushes consume from other threads. */
+   class LogWriter {
+    public:
+      LogWriter()
+      {
+         for (std::size_t i {0}; i < kRingSize; ++i)
+            cells_.at(i).sequence.store(i, std::memory_order_relaxed);
+         writer_ = std::async(std::launch::async, [this] {
+            rsj::LabelThread(L"AsyncLogger writer thread");
+            MIDI2LR_FAST_FLOATS;
+            Run();
+         });
+      }
+
+      ~LogWriter()
+      {
+         /* logger may already be gone during static destruction, so stop without writing */
+         try {
+            stop_.store(true, std::memory_order_release);
+            if (writer_.valid())
+               writer_.wait();
+         }
+         catch (...) { //-V565
+         }
+      }
+
+      LogWriter(const LogWriter& other) = delete;
+      LogWriter(LogWriter&& other) = delete;
+      LogWriter& operator=(const LogWriter& other) = delete;
+      LogWriter& operator=(LogWriter&& other) = delete;
+
+      [[nodiscard]] bool Stopped() const noexcept
+      {
+         return stopped_.load(std::memory_order_acquire);
+      }
+
+      void Push(gsl::czstring<> file, std::uint_least32_t line, std::string_view text) noexcept
+      {
+         const auto now {juce::Time::currentTimeMillis()};
+         std::uint32_t suppressed {0};
+         if (!Admit(SiteHash(file, line, text), now, suppressed))
+            return;
+         auto pos {enqueue_pos_.load(std::memory_order_relaxed)};
+         RingCell* cell {nullptr};
+         for (;;) {
+            cell = &cells_[pos & (kRingSize - 1)];
+            const auto seq {cell->sequence.load(std::memory_order_acquire)};
+            const auto diff {static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos)};
+            if (diff == 0) {
+               if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                  break;
+            }
+            else if (diff < 0) {
+               dropped_.fetch_add(1, std::memory_order_relaxed);
+               return;
+            }
+            else
+               pos = enqueue_pos_.load(std::memory_order_relaxed);
+         }
+         auto& record {cell->record};
+         record.time_ms = now;
+         record.file = file;
+         record.line = line;
+         record.suppressed = suppressed;
+         auto length {std::min(text.size(), kPayloadSize)};
+         if (length < text.size()) /* don't split a UTF-8 sequence */
+            while (length > 0 && (rsj::CharToInt(text[length]) & 0xC0) == 0x80)
+               --length;
+         text.copy(record.payload.data(), length);
+         record.length = length;
+         cell->sequence.store(pos + 1, std::memory_order_release);
+      }
+
+      void Stop() noexcept
+      {
+         try {
+            if (stopped_.exchange(true, std::memory_order_acq_rel))
+               return;
+            stop_.store(true, std::memory_order_release);
+            if (writer_.valid())
+               writer_.get();
+            Drain();
+         }
+         catch (...) { //-V565
+         }
+      }
+
+      /* the queue is written first so the record keeps its place after what came before */
+      void WriteNow(gsl::czstring<> file, std::uint_least32_t line, std::string_view text) noexcept
+      {
+         try {
+            auto lock {std::scoped_lock(drain_mutex_)};
+            WriteBatch();
+            WriteRecord(file, line, text);
+         }
+         catch (...) { //-V565
+         }
+      }
+
+      void Flush() noexcept
+      {
+         try {
+            if (auto lock {std::unique_lock(drain_mutex_, std::defer_lock)};
+                lock.try_lock_for(4 * kWriterPeriod))
+               WriteBatch();
+         }
+         catch (...) { //-V565
+         }
+      }
+
+    private:
+      [[nodiscard]] bool Admit(
+          std::size_t site, std::int64_t now_ms, std::uint32_t& suppressed) noexcept
+      {
+         auto& budget {sites_[site & (kSiteCount - 1)]};
+         const auto second {now_ms / 1000};
+         auto seen {budget.second.load(std::memory_order_relaxed)};
+         if (seen != second
+             && budget.second.compare_exchange_strong(seen, second, std::memory_order_relaxed))
+            budget.count.store(0, std::memory_order_relaxed);
+         if (budget.count.fetch_add(1, std::memory_order_relaxed) >= rsj::kLogSiteBurst) {
+            budget.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+         }
+         suppressed = budget.suppressed.exchange(0, std::memory_order_relaxed);
+         return true;
+      }
+
+      [[nodiscard]] bool Pop(LogRecord& record) noexcept
+      {
+         auto& cell {cells_[dequeue_pos_ & (kRingSize - 1)]};
+         if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1)
+            return false;
+         record = cell.record;
+         cell.sequence.store(dequeue_pos_ + kRingSize, std::memory_order_release);
+         ++dequeue_pos_;
+         return true;
+      }
+
+      void Run()
+      {
+         while (!stop_.load(std::memory_order_acquire)) {
+            Drain();
+            std::this_thread::sleep_for(kWriterPeriod);
+         }
+      }
+
+      void Drain() noexcept
+      {
+         try {
+            auto lock {std::scoped_lock(drain_mutex_)};
+            WriteBatch();
+         }
+         catch (...) { //-V565
+         }
+      }
+
+      /* one writeToLog per batch: FileLogger opens and closes the file on every call. Caller
+       * holds drain_mutex_ */
+      void WriteBatch()
+      {
+         try {
+            juce::String batch {};
+            LogRecord record {};
+            while (Pop(record)) {
+               if (batch.isNotEmpty())
+                  batch << juce::newLine;
+               batch << FormatRecord(record);
+            }
+            if (const auto dropped {dropped_.exchange(0, std::memory_order_relaxed)}) {
+               if (batch.isNotEmpty())
+                  batch << juce::newLine;
+               batch << juce::Time::getCurrentTime().toISO8601(true) << ": "
+                     << juce::String(dropped) << " log lines dropped, log queue full";
+            }
+            if (batch.isNotEmpty() && juce::Logger::getCurrentLogger())
+               juce::Logger::writeToLog(batch);
+         }
+         catch (...) { //-V565
+         }
+      }
+
+      alignas(64) std::atomic<std::size_t> enqueue_pos_ {0};
+      alignas(64) std::size_t dequeue_pos_ {0};
+      std::atomic<bool> stop_ {false};
+      std::atomic<bool> stopped_ {false};
+      std::atomic<std::uint64_t> dropped_ {0};
+      std::timed_mutex drain_mutex_; /* guards dequeue_pos_ and the consumer side of cells_ */
+      std::array<RingCell, kRingSize> cells_ {};
+      std::array<SiteBudget, kSiteCount> sites_ {};
+      std::future<void> writer_ {};
+   };
+
+   LogWriter& Writer()
+   {
+      static LogWriter writer {};
+      return writer;
+   }
+} // namespace
+
+void rsj::EnqueueLog(
+    gsl::czstring<> file, std::uint_least32_t line, std::string_view text) noexcept
+{
+   try {
+      auto& writer {Writer()};
+      if (!writer.Stopped()) {
+         writer.Push(file, line, text);
+         return;
+      }
+      WriteRecord(file, line, text);
+   }
+   catch (...) { //-V565
+   }
+}
+
+void rsj::WriteLogNow(
+    gsl::czstring<> file, std::uint_least32_t line, std::string_view text) noexcept
+{
+   try {
+      Writer().WriteNow(file, line, text);
+   }
+   catch (...) { //-V565
+   }
+}
+
+void rsj::FlushLog() noexcept
+{
+   try {
+      Writer().Flush();
+   }
+   catch (...) { //-V565
+   }
+}
+
+void rsj::StopLogThread() noexcept
+{
+   try {
+      Writer().Stop();
+   }
+   catch (...) { //-V565
+   }
+}
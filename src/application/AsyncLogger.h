@@ -0,0 +1,43 @@
+#ifndef MIDI2LR_ASYNCLOGGER_H_INCLUDED
+#define MIDI2LR_ASYNCLOGGER_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <cstdint>
+#include <string_view>
+
+#include <gsl/gsl>
+
+namespace rsj {
+   /* rsj::Log hands its text to EnqueueLog, which copies it into a fixed-size lock-free ring and
+    * returns; a background thread formats the records and writes them to the current
+    * juce::Logger in batches. Each call site (file and line, or the start of the text when
+    * source_location isn't available) may log at most kLogSiteBurst lines per second; the count of
+    * lines dropped by that limit, or because the ring was full, is written with the next line that
+    * gets through. Text longer than the record payload is truncated. */
+   void EnqueueLog(gsl::czstring<> file, std::uint_least32_t line, std::string_view text) noexcept;
+   /* For errors: skips the rate limit and the ring. Whatever is queued is written first, then the
+    * text, before returning, so the report is on disk even if the process ends next. */
+   void WriteLogNow(gsl::czstring<> file, std::uint_least32_t line, std::string_view text) noexcept;
+   /* Writes whatever is queued before returning. Safe to call from a terminate handler: gives up
+    * if the writer can't be had within a few writer periods. */
+   void FlushLog() noexcept;
+   /* Drains the ring and joins the writer thread. Must be called before the current juce::Logger
+    * is destroyed. Later calls to EnqueueLog write synchronously. */
+   void StopLogThread() noexcept;
+   inline constexpr int kLogSiteBurst {20};
+} // namespace rsj
+
+#endif
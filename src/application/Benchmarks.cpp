@@ -0,0 +1,360 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "Benchmarks.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "AllocationAccounting.h"
+#include "CommandSet.h"
+#include "Concurrency.h"
+#include "ControlsModel.h"
+#include "LR_IPC_In.h"
+#include "MidiUtilities.h"
+#include "Misc.h"
+#include "Profile.h"
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+   constexpr auto kMinDuration {std::chrono::milliseconds(200)};
+   constexpr std::uint64_t kMaxOperations {std::uint64_t {1} << 32};
+   constexpr std::uint64_t kThreadedOperations {200'000}; /* per thread */
+   constexpr int kContendingThreads {4};
+   constexpr int kControl {7};
+   /* results are stored here so the optimizer can't discard the measured calls. Only one thread
+    * at a time consumes results */
+   volatile std::uint64_t sink {0};
+
+   template<typename T> void Consume(const T value) noexcept
+   {
+      sink = static_cast<std::uint64_t>(value);
+   }
+
+   rsj::BenchmarkResult MakeResult(std::string name, const std::uint64_t operations,
+       const Clock::duration elapsed, const std::uint64_t allocations)
+   {
+      const auto ops {static_cast<double>(operations)};
+      return {std::move(name), operations,
+          static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+              / ops,
+          rsj::kAllocAccounting ? static_cast<double>(allocations) / ops : -1.0};
+   }
+
+   /* Runs operation(i) in a loop, quadrupling the count until a run lasts kMinDuration. The short
+    * runs double as warm-up */
+   template<typename Operation>
+   rsj::BenchmarkResult Measure(std::string name, Operation&& operation)
+   {
+      for (std::uint64_t operations {64};; operations *= 4) {
+         const auto allocations {rsj::ThreadAllocations()};
+         const auto start {Clock::now()};
+         for (std::uint64_t i {0}; i < operations; ++i) Consume(operation(i));
+         const auto elapsed {Clock::now() - start};
+         if (elapsed >= kMinDuration || operations >= kMaxOperations)
+            return MakeResult(
+                std::move(name), operations, elapsed, rsj::ThreadAllocations() - allocations);
+      }
+   }
+
+   /* Starts body(thread) on each of threads threads at once and times them all to completion.
+    * operations is the total across threads */
+   template<typename Body>
+   rsj::BenchmarkResult MeasureThreads(
+       std::string name, const int threads, const std::uint64_t operations, Body&& body)
+   {
+      std::atomic<int> ready {0};
+      std::atomic<bool> go {false};
+      std::atomic<std::uint64_t> allocations {0};
+      std::vector<std::thread> workers {};
+      workers.reserve(static_cast<size_t>(threads));
+      for (int thread {0}; thread < threads; ++thread)
+         workers.emplace_back([&, thread] {
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            const auto before {rsj::ThreadAllocations()};
+            body(thread);
+            allocations.fetch_add(rsj::ThreadAllocations() - before, std::memory_order_relaxed);
+         });
+      while (ready.load(std::memory_order_acquire) < threads) std::this_thread::yield();
+      const auto start {Clock::now()};
+      go.store(true, std::memory_order_release);
+      for (auto& worker : workers) worker.join();
+      return MakeResult(std::move(name), operations, Clock::now() - start, allocations.load());
+   }
+
+   template<class Container>
+   void QueueBenchmarks(const char* container, std::vector<rsj::BenchmarkResult>& results)
+   {
+      for (const int producers : {1, kContendingThreads}) {
+         rsj::ConcurrentQueue<rsj::MidiMessage, Container> queue {};
+         const auto total {kThreadedOperations * static_cast<std::uint64_t>(producers)};
+         results.push_back(MeasureThreads(
+             fmt::format(
+                 FMT_STRING("ConcurrentQueue<{}> push/pop, {} producer(s)"), container, producers),
+             producers + 1, total, [&queue, total](const int thread) {
+                if (thread == 0) {
+                   for (std::uint64_t i {0}; i < total; ++i) Consume(queue.pop().value);
+                   return;
+                }
+                for (std::uint64_t i {0}; i < kThreadedOperations; ++i)
+                   queue.push(
+                       {rsj::MessageType::kCc, thread, kControl, static_cast<int>(i & 0x7F)});
+             }));
+      }
+   }
+
+   void SpinLockBenchmarks(std::vector<rsj::BenchmarkResult>& results)
+   {
+      rsj::SpinLock lock {};
+      std::uint64_t counter {0};
+      results.push_back(Measure("SpinLock lock/unlock, uncontended", [&](std::uint64_t) {
+         auto guard {std::scoped_lock(lock)};
+         return ++counter;
+      }));
+      results.push_back(MeasureThreads(
+          fmt::format(FMT_STRING("SpinLock lock/unlock, {} threads"), kContendingThreads),
+          kContendingThreads, kThreadedOperations * kContendingThreads, [&](int) {
+             for (std::uint64_t i {0}; i < kThreadedOperations; ++i) {
+                auto guard {std::scoped_lock(lock)};
+                ++counter;
+             }
+          }));
+      Consume(counter);
+   }
+
+   void NrpnFilterBenchmarks(std::vector<rsj::BenchmarkResult>& results)
+   {
+      /* one complete NRPN (parameter 0x0107, value 0x1234) followed by an ordinary CC */
+      constexpr std::array kStream {rsj::MidiMessage {rsj::MessageType::kCc, 0, 99, 0x02},
+          rsj::MidiMessage {rsj::MessageType::kCc, 0, 98, 0x07},
+          rsj::MidiMessage {rsj::MessageType::kCc, 0, 6, 0x24},
+          rsj::MidiMessage {rsj::MessageType::kCc, 0, 38, 0x34},
+          rsj::MidiMessage {rsj::MessageType::kCc, 0, kControl, 0x40}};
+      NrpnFilter filter {};
+      results.push_back(Measure("NrpnFilter::operator()", [&](const std::uint64_t i) {
+         const auto result {filter(kStream.at(i % kStream.size()))};
+         return result.is_ready ? result.value : result.is_nrpn;
+      }));
+   }
+
+   /* relative encodings of +1, +1, -1, +2, so the control wanders without pinning at an end */
+   constexpr std::array<int, 4> RelativeSteps(const rsj::CCmethod method) noexcept
+   {
+      switch (method) {
+      case rsj::CCmethod::kTwosComplement:
+         return {1, 1, 0x7F, 2};
+      case rsj::CCmethod::kBinaryOffset:
+         return {0x41, 0x41, 0x3F, 0x42};
+      case rsj::CCmethod::kSignMagnitude:
+         return {1, 1, 0x41, 2};
+      case rsj::CCmethod::kAbsolute:
+         break;
+      }
+      return {0, 0, 0, 0};
+   }
+
+   void ChannelModelBenchmarks(std::vector<rsj::BenchmarkResult>& results)
+   {
+      constexpr std::array kMethods {std::pair {rsj::CCmethod::kAbsolute, "absolute"},
+          std::pair {rsj::CCmethod::kTwosComplement, "twos complement"},
+          std::pair {rsj::CCmethod::kBinaryOffset, "binary offset"},
+          std::pair {rsj::CCmethod::kSignMagnitude, "sign magnitude"}};
+      for (const auto& [method, label] : kMethods) {
+         ChannelModel model {};
+         model.SetCc(kControl, 0, 0x7F, method);
+         const auto steps {RelativeSteps(method)};
+         const auto value_for {[method = method, steps](const std::uint64_t i) {
+            return method == rsj::CCmethod::kAbsolute ? static_cast<int>(i & 0x7F)
+                                                       : steps.at(i % steps.size());
+         }};
+         results.push_back(Measure(
+             fmt::format(FMT_STRING("ChannelModel::ControllerToPlugin, {}"), label),
+             [&](const std::uint64_t i) {
+                return model.ControllerToPlugin(
+                           rsj::MessageType::kCc, kControl, value_for(i), false)
+                       * 1000.0;
+             }));
+         results.push_back(
+             Measure(fmt::format(FMT_STRING("ChannelModel::MeasureChange, {}"), label),
+                 [&](const std::uint64_t i) {
+                    return model.MeasureChange(rsj::MessageType::kCc, kControl, value_for(i));
+                 }));
+         results.push_back(
+             Measure(fmt::format(FMT_STRING("ChannelModel::PluginToController, {}"), label),
+                 [&](const std::uint64_t i) {
+                    return model.PluginToController(
+                        rsj::MessageType::kCc, kControl, static_cast<double>(i % 101) / 100.0);
+                 }));
+      }
+   }
+
+   /* a recorded fader sweep: bursts of absolute CCs, a few channels at a time, as replay feeds
+    * them. Converted one by one as live input is, and as a run */
+   void ControlsModelBenchmarks(std::vector<rsj::BenchmarkResult>& results)
+   {
+      constexpr size_t kBurst {128};
+      constexpr int kChannels {4};
+      const auto model {std::make_unique<ControlsModel>()};
+      std::vector<rsj::MidiMessage> burst {};
+      burst.reserve(kBurst);
+      for (size_t i {0}; i < kBurst; ++i) {
+         const auto channel {static_cast<int>(i * kChannels / kBurst)};
+         model->SetCc(channel, kControl, 0, 0x7F, rsj::CCmethod::kAbsolute);
+         burst.push_back({rsj::MessageType::kCc, channel, kControl, static_cast<int>(i & 0x7F)});
+      }
+      std::vector<double> converted(kBurst);
+      results.push_back(Measure(
+          fmt::format(FMT_STRING("ControlsModel::ControllerToPlugin, {} messages"), kBurst),
+          [&](std::uint64_t) {
+             for (size_t i {0}; i < kBurst; ++i)
+                converted[i] = model->ControllerToPlugin(burst[i], false);
+             return converted.back() * 1000.0;
+          }));
+      results.push_back(Measure(
+          fmt::format(FMT_STRING("ControlsModel::ControllerToPluginBatch, {} messages"), kBurst),
+          [&](std::uint64_t) {
+             model->ControllerToPluginBatch(burst, false, converted);
+             return converted.back() * 1000.0;
+          }));
+   }
+
+   /* messages spread across all sixteen channels, commands assigned round robin so each command
+    * has several messages */
+   rsj::MidiMessageId MessageForRow(const size_t row) noexcept
+   {
+      return {static_cast<int>(row % 16) + 1, static_cast<int>(row / 16), rsj::MessageType::kCc};
+   }
+
+   void ProfileBenchmarks(const CommandSet& command_set, std::vector<rsj::BenchmarkResult>& results)
+   {
+      const auto commands {command_set.CommandAbbrevSize() - 1}; /* skip Unassigned */
+      for (const size_t rows : {size_t {1'000}, size_t {16'000}}) {
+         Profile::Builder builder {command_set};
+         builder.Reserve(rows);
+         for (size_t row {0}; row < rows; ++row)
+            builder.Add(command_set.CommandAbbrevAt(1 + row % commands), MessageForRow(row));
+         Profile profile {command_set};
+         profile.Assign(builder.Build());
+         results.push_back(
+             Measure(fmt::format(FMT_STRING("Profile::GetCommandForMessage, {} rows"), rows),
+                 [&](const std::uint64_t i) {
+                    return profile.GetCommandForMessage(MessageForRow(i * 7919 % rows)).size();
+                 }));
+         results.push_back(
+             Measure(fmt::format(FMT_STRING("Profile::GetMessagesForCommand, {} rows"), rows),
+                 [&](const std::uint64_t i) {
+                    return profile
+                        .GetMessagesForCommand(command_set.CommandAbbrevAt(1 + i % commands))
+                        .size();
+                 }));
+      }
+   }
+
+   void CommandSetBenchmarks(
+       const CommandSet& command_set, std::vector<rsj::BenchmarkResult>& results)
+   {
+      /* only known commands: a miss is logged */
+      const auto commands {command_set.CommandAbbrevSize()};
+      results.push_back(Measure("CommandSet::CommandTextIndex", [&](const std::uint64_t i) {
+         return command_set.CommandTextIndex(command_set.CommandAbbrevAt(i % commands));
+      }));
+   }
+
+   void LineSplitterBenchmarks(std::vector<rsj::BenchmarkResult>& results)
+   {
+      constexpr std::array<std::string_view, 4> kLines {"Exposure 0.51234\n",
+          "SwitchProfile Portrait.xml\n", "  Temperature\t0.25 \n", "Pickup 1\n"};
+      results.push_back(Measure("LrIpcIn line splitter", [&](const std::uint64_t i) {
+         const auto [command, value] {rsj::SplitLine(kLines.at(i % kLines.size()))};
+         return command.size() + value.size();
+      }));
+      /* as the plugin's lines arrive: copied out of the socket buffer, then split */
+      results.push_back(Measure("LrIpcIn line copy and split", [&](const std::uint64_t i) {
+         const std::string line {kLines.at(i % kLines.size())};
+         const auto [command, value] {rsj::SplitLine(line)};
+         return command.size() + value.size();
+      }));
+   }
+} // namespace
+
+std::vector<rsj::BenchmarkResult> rsj::RunBenchmarks(const CommandSet& command_set)
+{
+   try {
+      std::vector<BenchmarkResult> results {};
+      QueueBenchmarks<std::deque<MidiMessage>>("deque", results);
+      QueueBenchmarks<RingDeque<MidiMessage>>("RingDeque", results);
+      SpinLockBenchmarks(results);
+      NrpnFilterBenchmarks(results);
+      ChannelModelBenchmarks(results);
+      ControlsModelBenchmarks(results);
+      ProfileBenchmarks(command_set, results);
+      CommandSetBenchmarks(command_set, results);
+      LineSplitterBenchmarks(results);
+      return results;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+std::string rsj::FormatBenchmarks(const std::vector<BenchmarkResult>& results, const bool json)
+{
+   try {
+      std::string out {};
+      if (json) {
+         out += fmt::format(
+             FMT_STRING("{{\"allocations_counted\":{},\"benchmarks\":["), rsj::kAllocAccounting);
+         for (const auto& result : results) {
+            if (&result != &results.front())
+               out += ',';
+            out += fmt::format(
+                FMT_STRING("\n{{\"name\":\"{}\",\"operations\":{},\"ns_per_op\":{:.3f},"
+                           "\"allocs_per_op\":{}}}"),
+                result.name, result.operations, result.ns_per_op,
+                result.allocs_per_op < 0.0 ? std::string("null")
+                                           : fmt::format(FMT_STRING("{:.3f}"),
+                                               result.allocs_per_op));
+         }
+         out += "\n]}\n";
+         return out;
+      }
+      out += fmt::format(FMT_STRING("{:<52}{:>12}{:>12}{:>14}\n"), "benchmark", "ns/op",
+          "allocs/op", "operations");
+      for (const auto& result : results)
+         out += fmt::format(FMT_STRING("{:<52}{:>12.1f}{:>12}{:>14}\n"), result.name,
+             result.ns_per_op,
+             result.allocs_per_op < 0.0
+                 ? std::string("-")
+                 : fmt::format(FMT_STRING("{:.2f}"), result.allocs_per_op),
+             result.operations);
+      return out;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
@@ -0,0 +1,40 @@
+#ifndef MIDI2LR_BENCHMARKS_H_INCLUDED
+#define MIDI2LR_BENCHMARKS_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CommandSet;
+
+namespace rsj {
+   struct BenchmarkResult {
+      std::string name;
+      std::uint64_t operations {0};
+      double ns_per_op {0.0};
+      double allocs_per_op {-1.0}; /* negative when the build doesn't count allocations */
+   };
+
+   /* Times the engine primitives. Takes several seconds; run it before the rest of the app starts
+    * so other threads don't disturb the timings. Allocations are counted only in builds that
+    * define MIDI2LR_ALLOC_ACCOUNTING */
+   [[nodiscard]] std::vector<BenchmarkResult> RunBenchmarks(const CommandSet& command_set);
+   [[nodiscard]] std::string FormatBenchmarks(
+       const std::vector<BenchmarkResult>& results, bool json);
+} // namespace rsj
+
+#endif
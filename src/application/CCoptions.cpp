@@ -175,6 +175,24 @@ CCoptions::CCoptions()
    minvaltext->setInputFilter(&numrestrict_, false);
    maxvaltext->addListener(this);
    minvaltext->addListener(this);
+   deadbandtext_.reset(new TextEditor("deadbandtext"));
+   addAndMakeVisible(deadbandtext_.get());
+   deadbandtext_->setTooltip(TRANS("Ignore changes this small or smaller, to quiet a jittery "
+                                   "fader or knob. 0 passes every change."));
+   deadbandtext_->setExplicitFocusOrder(7);
+   deadbandtext_->setMultiLine(false);
+   deadbandtext_->setReturnKeyStartsNewLine(false);
+   deadbandtext_->setText("0");
+   deadbandtext_->setBounds(200, 308, 56, 24);
+   deadbandtext_->setInputFilter(&numrestrict_, false);
+   deadbandtext_->addListener(this);
+   deadbandlabel_.reset(new Label("deadbandlabel", TRANS("Deadband")));
+   addAndMakeVisible(deadbandlabel_.get());
+   deadbandlabel_->setFont(Font(15.00f, Font::plain).withTypefaceStyle("Regular"));
+   deadbandlabel_->setJustificationType(Justification::centredLeft);
+   deadbandlabel_->setBounds(16, 308, 150, 24);
+   applyAll->setExplicitFocusOrder(8);
+   setSize(280, 400);
    //[/Constructor]
 }
 
@@ -196,6 +214,8 @@ CCoptions::~CCoptions()
    controlID = nullptr;
 
    //[Destructor]. You can add your own custom destruction code here..
+   deadbandtext_ = nullptr;
+   deadbandlabel_ = nullptr;
    //[/Destructor]
 }
 
@@ -234,6 +254,8 @@ void CCoptions::buttonClicked(Button* buttonThatWasClicked)
       maxvallabel->setText(TRANS("Resolution"), juce::dontSendNotification);
       minvaltext->setText("0", juce::dontSendNotification);
       controls_model_->SetCcMethod(bound_channel_, bound_number_, rsj::CCmethod::kTwosComplement);
+      deadbandtext_->setVisible(false);
+      deadbandlabel_->setVisible(false);
       //[/UserButtonCode_twosbutton]
    }
    else if (buttonThatWasClicked == absbutton.get()) {
@@ -242,6 +264,8 @@ void CCoptions::buttonClicked(Button* buttonThatWasClicked)
       minvallabel->setVisible(true);
       maxvallabel->setText(TRANS("Maximum value"), juce::dontSendNotification);
       controls_model_->SetCcMethod(bound_channel_, bound_number_, rsj::CCmethod::kAbsolute);
+      deadbandtext_->setVisible(true);
+      deadbandlabel_->setVisible(true);
       //[/UserButtonCode_absbutton]
    }
    else if (buttonThatWasClicked == binbutton.get()) {
@@ -251,6 +275,8 @@ void CCoptions::buttonClicked(Button* buttonThatWasClicked)
       maxvallabel->setText(TRANS("Resolution"), juce::dontSendNotification);
       minvaltext->setText("0", juce::dontSendNotification);
       controls_model_->SetCcMethod(bound_channel_, bound_number_, rsj::CCmethod::kBinaryOffset);
+      deadbandtext_->setVisible(false);
+      deadbandlabel_->setVisible(false);
 
       //[/UserButtonCode_binbutton]
    }
@@ -261,6 +287,8 @@ void CCoptions::buttonClicked(Button* buttonThatWasClicked)
       maxvallabel->setText(TRANS("Resolution"), juce::dontSendNotification);
       minvaltext->setText("0", juce::dontSendNotification);
       controls_model_->SetCcMethod(bound_channel_, bound_number_, rsj::CCmethod::kSignMagnitude);
+      deadbandtext_->setVisible(false);
+      deadbandlabel_->setVisible(false);
       //[/UserButtonCode_signbutton]
    }
    else if (buttonThatWasClicked == applyAll.get()) {
@@ -278,7 +306,7 @@ void CCoptions::buttonClicked(Button* buttonThatWasClicked)
          throw std::logic_error("CCoptions::buttonClicked reached unreachable code");
       }
       controls_model_->SetCcAll(bound_channel_, bound_number_, minvaltext->getText().getIntValue(),
-          maxvaltext->getText().getIntValue(), ccm);
+          maxvaltext->getText().getIntValue(), ccm, deadbandtext_->getText().getIntValue());
       //[/UserButtonCode_applyAll]
    }
 
@@ -295,6 +323,13 @@ void CCoptions::textEditorFocusLost(TextEditor& t)
       controls_model_->SetCcMin(bound_channel_, bound_number_, val);
    else if (nam == "maxvaltext")
       controls_model_->SetCcMax(bound_channel_, bound_number_, val);
+   else if (nam == "deadbandtext") {
+      controls_model_->SetCcDeadband(bound_channel_, bound_number_, val);
+      /* show what was kept after clamping to the range */
+      deadbandtext_->setText(
+          juce::String(controls_model_->GetCcDeadband(bound_channel_, bound_number_)),
+          juce::dontSendNotification);
+   }
 }
 
 void CCoptions::BindToControl(const int channel, const int control_number)
@@ -308,6 +343,9 @@ void CCoptions::BindToControl(const int channel, const int control_number)
        juce::dontSendNotification);
    maxvaltext->setText(juce::String(controls_model_->GetCcMax(bound_channel_, bound_number_)),
        juce::dontSendNotification);
+   deadbandtext_->setText(
+       juce::String(controls_model_->GetCcDeadband(bound_channel_, bound_number_)),
+       juce::dontSendNotification);
    switch (controls_model_->GetCcMethod(bound_channel_, bound_number_)) {
    case rsj::CCmethod::kAbsolute:
       absbutton->setToggleState(true, juce::sendNotification);
@@ -87,6 +87,8 @@ class CCoptions  : public juce::Component,
    inline static ControlsModel* controls_model_{nullptr};
    int bound_channel_{0}; // note: 0-based in program, add one to compensate for display
    int bound_number_{0};
+   std::unique_ptr<juce::TextEditor> deadbandtext_;
+   std::unique_ptr<juce::Label> deadbandlabel_;
     //[/UserVariables]
 
     //==============================================================================
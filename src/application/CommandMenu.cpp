@@ -25,18 +25,42 @@
 #include "PWoptions.h"
 #include "Profile.h"
 
-CommandMenu::CommandMenu(
-    rsj::MidiMessageId message, const CommandSet& command_set, Profile& profile)
+CommandMenu::CommandMenu(rsj::MidiMessageId message, const CommandSet& command_set,
+    Profile& profile, const juce::PopupMenu& menu_template)
 try : TextButtonAligned {
    CommandSet::UnassignedTranslated()
 }
-, command_set_(command_set), profile_(profile), message_ {message} {}
+, command_set_(command_set), profile_(profile), menu_template_ {menu_template}, message_ {message}
+{
+}
 catch (const std::exception& e)
 {
    MIDI2LR_E_RESPONSE;
    throw;
 }
 
+juce::PopupMenu CommandMenu::BuildTemplate(const CommandSet& command_set)
+{
+   try {
+      /* item ids are one more than the command's index */
+      size_t index {1};
+      juce::PopupMenu main_menu;
+      main_menu.addItem(gsl::narrow_cast<int>(index++), CommandSet::UnassignedTranslated());
+      size_t submenu_number {0}; /* to track name for submenu */
+      for (const auto& submenus : command_set.GetMenuEntries()) {
+         juce::PopupMenu sub_menu;
+         for (const auto& command : submenus)
+            sub_menu.addItem(gsl::narrow_cast<int>(index++), command);
+         main_menu.addSubMenu(command_set.GetMenus().at(submenu_number++), sub_menu);
+      }
+      return main_menu;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
 void CommandMenu::clicked(const juce::ModifierKeys& modifiers)
 {
    try {
@@ -68,31 +92,27 @@ void CommandMenu::clicked(const juce::ModifierKeys& modifiers)
          }
       }
       else {
-         size_t index {1};
-         juce::PopupMenu main_menu;
-         main_menu.addItem(gsl::narrow_cast<int>(index), CommandSet::UnassignedTranslated(), true,
-             index == selected_item_);
-         index++;
-         size_t submenu_number {0}; /* to track name for submenu */
-         /* add each submenu */
-         for (const auto& submenus : command_set_.GetMenuEntries()) {
-            auto tick_menu {false}; /* tick when submenu item is currently selected */
-            juce::PopupMenu sub_menu;
-            for (const auto& command : submenus) {
-               /* add each submenu entry, ticking the previously selected entry and marking used
-                * entries red */
-               if (profile_.CommandHasAssociatedMessage(command_set_.CommandAbbrevAt(index - 1))) {
-                  const auto tick_item {index == selected_item_};
-                  tick_menu |= tick_item;
-                  sub_menu.addColouredItem(
-                      gsl::narrow_cast<int>(index), command, juce::Colours::red, true, tick_item);
+         /* mark a copy of the shared menu: tick the previously selected entry and its submenu, and
+          * colour used entries red. One look at the profile serves the whole menu */
+         auto main_menu {menu_template_};
+         const auto contents {profile_.GetContents()};
+         const auto& used {contents->command_string_map};
+         for (juce::PopupMenu::MenuItemIterator top {main_menu}; top.next();) {
+            auto& submenu_item {top.getItem()};
+            if (!submenu_item.subMenu) {
+               submenu_item.isTicked = rsj::cmp_equal(submenu_item.itemID, selected_item_);
+               continue;
+            }
+            for (juce::PopupMenu::MenuItemIterator entries {*submenu_item.subMenu};
+                 entries.next();) {
+               auto& item {entries.getItem()};
+               const auto index {gsl::narrow_cast<size_t>(item.itemID)};
+               if (used.find(command_set_.CommandAbbrevAt(index - 1)) != used.end()) {
+                  item.colour = juce::Colours::red;
+                  if (index == selected_item_)
+                     item.isTicked = submenu_item.isTicked = true;
                }
-               else
-                  sub_menu.addItem(gsl::narrow_cast<int>(index), command, true, false);
-               index++;
             }
-            main_menu.addSubMenu(
-                command_set_.GetMenus().at(submenu_number++), sub_menu, true, nullptr, tick_menu);
          }
          const auto result {gsl::narrow_cast<size_t>(main_menu.show())};
          if (result) {
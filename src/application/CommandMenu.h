@@ -28,7 +28,10 @@ class Profile;
 
 class CommandMenu final : public TextButtonAligned {
  public:
-   CommandMenu(rsj::MidiMessageId message, const CommandSet& command_set, Profile& profile);
+   CommandMenu(rsj::MidiMessageId message, const CommandSet& command_set, Profile& profile,
+       const juce::PopupMenu& menu_template);
+   /* every command in its submenu, unmarked. Built once and shared by all rows */
+   [[nodiscard]] static juce::PopupMenu BuildTemplate(const CommandSet& command_set);
 
    void SetMsg(rsj::MidiMessageId message) noexcept { message_ = message; }
 
@@ -44,6 +47,7 @@ class CommandMenu final : public TextButtonAligned {
 
    const CommandSet& command_set_;
    Profile& profile_;
+   const juce::PopupMenu& menu_template_;
    rsj::MidiMessageId message_;
    size_t selected_item_ {std::numeric_limits<decltype(selected_item_)>::max()};
 };
@@ -26,11 +26,64 @@
 #include "CommandMenu.h"
 #include "Misc.h"
 
+namespace {
+   std::string MessageText(const rsj::MidiMessageId cmd)
+   {
+      switch (cmd.msg_id_type) {
+      case rsj::MessageType::kNoteOn:
+         return fmt::format(FMT_STRING("{} | Note : {}"), cmd.channel, cmd.control_number);
+      case rsj::MessageType::kNoteOff:
+         return fmt::format(FMT_STRING("{} | Note Off: {}"), cmd.channel, cmd.control_number);
+      case rsj::MessageType::kCc:
+         return fmt::format(FMT_STRING("{} | CC: {}"), cmd.channel, cmd.control_number);
+      case rsj::MessageType::kPw:
+         return fmt::format(FMT_STRING("{} | Pitch Bend"), cmd.channel);
+      case rsj::MessageType::kKeyPressure:
+         return fmt::format(FMT_STRING("{} | Key Pressure: {}"), cmd.channel, cmd.control_number);
+      case rsj::MessageType::kChanPressure:
+         return fmt::format(FMT_STRING("{} | Channel Pressure"), cmd.channel);
+      case rsj::MessageType::kPgmChange:
+         return fmt::format(FMT_STRING("{} | Program Change"), cmd.channel);
+      case rsj::MessageType::kSystem:
+         break;
+      }
+      return {};
+   }
+} // namespace
+
 CommandTableModel::CommandTableModel(const CommandSet& command_set, Profile& profile) noexcept
     : command_set_ {command_set}, profile_ {profile}
 {
 }
 
+/* returns nullptr for rows past the end of the profile. Painting and scrolling then cost no
+ * formatting and no profile lookups until the profile changes */
+const CommandTableModel::RowDisplay* CommandTableModel::DisplayFor(const int row_number)
+{
+   try {
+      if (const auto generation {profile_.GetGeneration()}; generation != cache_generation_) {
+         row_cache_.clear();
+         row_cache_.resize(profile_.Size());
+         cache_generation_ = generation;
+      }
+      if (row_number < 0 || rsj::cmp_less_equal(row_cache_.size(), row_number))
+         return nullptr;
+      auto& entry {row_cache_.at(gsl::narrow_cast<size_t>(row_number))};
+      if (!entry.valid) {
+         entry.message = profile_.GetMessageForNumber(gsl::narrow_cast<size_t>(row_number));
+         entry.text = MessageText(entry.message);
+         entry.selected_item =
+             command_set_.CommandTextIndex(profile_.GetCommandForMessage(entry.message)) + 1;
+         entry.valid = true;
+      }
+      return &entry;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 void CommandTableModel::paintCell(juce::Graphics& g, int row_number, const int column_id,
     const int width, const int height, bool /*rowIsSelected*/)
 {
@@ -43,47 +96,15 @@ void CommandTableModel::paintCell(juce::Graphics& g, int row_number, const int c
       g.setFont(std::min(16.0f, static_cast<float>(height) * 0.7f));
       if (column_id == 1) {
          /* write the MIDI message in the MIDI command column */
-         if (rsj::cmp_less_equal(profile_.Size(), row_number)) {
+         if (const auto* const display {DisplayFor(row_number)})
+            g.drawText(display->text, 0, 0, width, height, juce::Justification::centredLeft);
+         else {
             /* error condition */
             g.drawText("Unknown control", 0, 0, width, height, juce::Justification::centred);
             rsj::Log(fmt::format(FMT_STRING("Unknown control CommandTableModel::paintCell. {} rows "
                                             "in profile, row number to be painted is {}."),
                 profile_.Size(), row_number));
          }
-         else {
-            std::string format_str;
-            switch (
-                const auto cmd {profile_.GetMessageForNumber(gsl::narrow_cast<size_t>(row_number))};
-                cmd.msg_id_type) {
-            case rsj::MessageType::kNoteOn:
-               format_str =
-                   fmt::format(FMT_STRING("{} | Note : {}"), cmd.channel, cmd.control_number);
-               break;
-            case rsj::MessageType::kNoteOff:
-               format_str =
-                   fmt::format(FMT_STRING("{} | Note Off: {}"), cmd.channel, cmd.control_number);
-               break;
-            case rsj::MessageType::kCc:
-               format_str = fmt::format(FMT_STRING("{} | CC: {}"), cmd.channel, cmd.control_number);
-               break;
-            case rsj::MessageType::kPw:
-               format_str = fmt::format(FMT_STRING("{} | Pitch Bend"), cmd.channel);
-               break;
-            case rsj::MessageType::kKeyPressure:
-               format_str = fmt::format(
-                   FMT_STRING("{} | Key Pressure: {}"), cmd.channel, cmd.control_number);
-               break;
-            case rsj::MessageType::kChanPressure:
-               format_str = fmt::format(FMT_STRING("{} | Channel Pressure"), cmd.channel);
-               break;
-            case rsj::MessageType::kPgmChange:
-               format_str = fmt::format(FMT_STRING("{} | Program Change"), cmd.channel);
-               break;
-            case rsj::MessageType::kSystem:
-               break;
-            }
-            g.drawText(format_str, 0, 0, width, height, juce::Justification::centredLeft);
-         }
       }
    }
    catch (const std::exception& e) {
@@ -128,25 +149,26 @@ juce::Component* CommandTableModel::refreshComponentForCell(int row_number, cons
    try {
       if (column_id == 2) /* LR command column */
       {
+         const auto* const display {DisplayFor(row_number)};
+         if (!display) {
+            delete existing_component; // NOLINT(cppcoreguidelines-owning-memory)
+            return nullptr;
+         }
          auto command_select {dynamic_cast<CommandMenu*>(existing_component)};
          if (command_select == nullptr) {
             /* create a new command menu, delete old one if it exists */
             delete existing_component; // NOLINT(cppcoreguidelines-owning-memory)
+            if (!menu_template_)
+               menu_template_ =
+                   std::make_unique<juce::PopupMenu>(CommandMenu::BuildTemplate(command_set_));
             auto new_select {std::make_unique<CommandMenu>(
-                profile_.GetMessageForNumber(gsl::narrow_cast<size_t>(row_number)), command_set_,
-                profile_)};
-            new_select->SetSelectedItem(
-                command_set_.CommandTextIndex(profile_.GetCommandForMessage(
-                    profile_.GetMessageForNumber(gsl::narrow_cast<size_t>(row_number))))
-                + 1);
+                display->message, command_set_, profile_, *menu_template_)};
+            new_select->SetSelectedItem(display->selected_item);
             return new_select.release();
          }
          /* change old command menu */
-         command_select->SetMsg(profile_.GetMessageForNumber(gsl::narrow_cast<size_t>(row_number)));
-         command_select->SetSelectedItem(
-             command_set_.CommandTextIndex(profile_.GetCommandForMessage(
-                 profile_.GetMessageForNumber(gsl::narrow_cast<size_t>(row_number))))
-             + 1);
+         command_select->SetMsg(display->message);
+         command_select->SetSelectedItem(display->selected_item);
          return command_select;
       }
       return nullptr;
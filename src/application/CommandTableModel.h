@@ -16,6 +16,11 @@
  *
  */
 
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
 #include <juce_graphics/juce_graphics.h>
 #include <juce_gui_basics/juce_gui_basics.h>
 
@@ -33,6 +38,14 @@ class CommandTableModel final : public juce::TableListBoxModel {
    }
 
  private:
+   /* what a row shows, kept until the profile's generation moves on */
+   struct RowDisplay {
+      bool valid {false};
+      rsj::MidiMessageId message {};
+      juce::String text {};
+      size_t selected_item {0};
+   };
+   [[nodiscard]] const RowDisplay* DisplayFor(int row_number);
    [[nodiscard]] int getNumRows() override { return gsl::narrow_cast<int>(profile_.Size()); }
    void paintCell(juce::Graphics&, int row_number, int column_id, int width, int height,
        bool row_is_selected) override;
@@ -44,5 +57,8 @@ class CommandTableModel final : public juce::TableListBoxModel {
 
    const CommandSet& command_set_;
    Profile& profile_;
+   std::unique_ptr<juce::PopupMenu> menu_template_ {}; /* built for the first row shown */
+   std::vector<RowDisplay> row_cache_ {};
+   uint64_t cache_generation_ {std::numeric_limits<uint64_t>::max()};
 };
 #endif
\ No newline at end of file
@@ -28,6 +28,7 @@
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #ifndef __ARM_ARCH
 extern "C" {
 extern void _mm_pause();
@@ -128,6 +129,79 @@ namespace rsj {
       [[maybe_unused]] alignas(1) std::byte padding_[127];
    };
 
+   /* Container for ConcurrentQueue that keeps its storage: a circular buffer that doubles when
+    * full and never shrinks. std::deque allocates and frees blocks as items pass through it, so a
+    * queue that is steadily filled and drained never stops allocating. Elements must be default
+    * constructible and move assignable; popped slots are reset to T {} */
+   template<typename T> class RingDeque {
+    public:
+      using value_type = T;
+      using size_type = std::size_t;
+      using reference = T&;
+      using const_reference = const T&;
+
+      RingDeque() noexcept = default;
+      ~RingDeque() = default;
+      RingDeque(const RingDeque& other) = default;
+      RingDeque(RingDeque&& other) noexcept
+          : slots_ {std::move(other.slots_)}, head_ {std::exchange(other.head_, 0)},
+            size_ {std::exchange(other.size_, 0)}
+      {
+      }
+      RingDeque& operator=(const RingDeque& other) = default;
+      RingDeque& operator=(RingDeque&& other) noexcept
+      {
+         RingDeque(std::move(other)).swap(*this);
+         return *this;
+      }
+      [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+      [[nodiscard]] size_type size() const noexcept { return size_; }
+      [[nodiscard]] size_type max_size() const noexcept { return slots_.max_size(); }
+      [[nodiscard]] reference front() noexcept { return slots_[head_]; }
+      [[nodiscard]] const_reference front() const noexcept { return slots_[head_]; }
+      void push_back(const T& value) { emplace_back(value); }
+      void push_back(T&& value) { emplace_back(std::move(value)); }
+      template<class... Args> reference emplace_back(Args&&... args)
+      {
+         if (size_ == slots_.size())
+            Grow();
+         auto& slot {slots_[(head_ + size_) & (slots_.size() - 1)]};
+         slot = T {std::forward<Args>(args)...};
+         ++size_;
+         return slot;
+      }
+      void pop_front()
+      {
+         slots_[head_] = T {};
+         head_ = (head_ + 1) & (slots_.size() - 1);
+         --size_;
+      }
+      void clear()
+      {
+         while (!empty()) pop_front();
+      }
+      void swap(RingDeque& other) noexcept
+      {
+         slots_.swap(other.slots_);
+         std::swap(head_, other.head_);
+         std::swap(size_, other.size_);
+      }
+
+    private:
+      static constexpr size_type kInitialSlots {16}; /* power of two, as every later size */
+      void Grow()
+      {
+         std::vector<T> larger(slots_.empty() ? kInitialSlots : slots_.size() * 2);
+         for (size_type i {0}; i < size_; ++i)
+            larger[i] = std::move(slots_[(head_ + i) & (slots_.size() - 1)]);
+         slots_.swap(larger);
+         head_ = 0;
+      }
+      std::vector<T> slots_ {};
+      size_type head_ {0};
+      size_type size_ {0};
+   };
+
    /* all but blocking pops use scoped_lock. blocking pops use unique_lock */
    template<typename T, class Container = std::deque<T>, class Mutex = std::mutex>
    class ConcurrentQueue {
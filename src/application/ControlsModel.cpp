@@ -16,18 +16,269 @@
 #include "ControlsModel.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <map>
+#include <mutex>
 #include <stdexcept>
+#include <tuple>
+
+#ifndef __ARM_ARCH
+#include <emmintrin.h>
+#endif
 
 #include "MidiUtilities.h"
 #include "Misc.h"
 
-double ChannelModel::OffsetResult(const int diff, const int controlnumber, bool const wrap)
+namespace {
+   /* a reader holds a configuration snapshot only for one call, so this is ample */
+   constexpr auto kRetiredGrace {std::chrono::seconds(5)};
+
+   /* decoded change for each 7-bit input of the relative methods, indexed by CCmethod */
+   using DeltaTable = std::array<int, 0x80>;
+
+   constexpr DeltaTable MakeDeltaTable(const rsj::CCmethod method) noexcept
+   {
+      DeltaTable table {};
+      for (auto value {0}; value < 0x80; ++value) {
+         switch (method) {
+         case rsj::CCmethod::kAbsolute:
+            break;
+         case rsj::CCmethod::kBinaryOffset:
+            table[value] = value - 0x40;
+            break;
+         case rsj::CCmethod::kSignMagnitude:
+            table[value] = value & 0x40 ? -(value & 0x3F) : value;
+            break;
+         case rsj::CCmethod::kTwosComplement:
+            table[value] = value & 0x40 ? -((value ^ 0x7F) + 1) : value;
+            break;
+         }
+      }
+      return table;
+   }
+
+   constexpr std::array<DeltaTable, 4> kDeltaTables {MakeDeltaTable(rsj::CCmethod::kAbsolute),
+       MakeDeltaTable(rsj::CCmethod::kTwosComplement),
+       MakeDeltaTable(rsj::CCmethod::kBinaryOffset),
+       MakeDeltaTable(rsj::CCmethod::kSignMagnitude)};
+   static_assert(kDeltaTables.at(2).at(0x41) == 1 && kDeltaTables.at(3).at(0x41) == -1
+                 && kDeltaTables.at(1).at(0x7F) == -1);
+
+   [[nodiscard]] int DecodeDelta(const rsj::CCmethod method, const int value) noexcept
+   {
+#pragma warning(suppress : 26446 26482) /* method is an enum index, value checked by caller */
+      return kDeltaTables[static_cast<size_t>(method)][static_cast<size_t>(value)];
+   }
+
+   /* results[i] = lows[i] + lrint(values[i] * ranges[i]), with the product clamped to
+    * [0, ranges[i]]. Same result as the clamp in PluginToController, since the range is whole */
+   void ScaleToRange(gsl::span<const double> values, gsl::span<const double> ranges,
+       gsl::span<const int> lows, gsl::span<int> results) noexcept
+   {
+      const auto count {values.size()};
+      const auto* const value {values.data()};
+      const auto* const range {ranges.data()};
+      const auto* const low {lows.data()};
+      auto* const result {results.data()};
+      size_t i {0};
+#ifndef __ARM_ARCH
+      /* cvtpd rounds using MXCSR, round-to-nearest as lrint does */
+      const auto zero {_mm_setzero_pd()};
+      for (; i + 2 <= count; i += 2) {
+         const auto r {_mm_loadu_pd(range + i)};
+         const auto product {_mm_mul_pd(_mm_loadu_pd(value + i), r)};
+         const auto scaled {_mm_min_pd(_mm_max_pd(product, zero), r)};
+#pragma warning(suppress : 26490) /* intrinsics take __m128i pointers */
+         const auto l {_mm_loadl_epi64(reinterpret_cast<const __m128i*>(low + i))};
+#pragma warning(suppress : 26490)
+         _mm_storel_epi64(reinterpret_cast<__m128i*>(result + i),
+             _mm_add_epi32(_mm_cvtpd_epi32(scaled), l));
+      }
+#endif
+      for (; i < count; ++i)
+         result[i] =
+             low[i]
+             + gsl::narrow_cast<int>(std::lrint(std::clamp(value[i] * range[i], 0.0, range[i])));
+   }
+} // namespace
+
+const ChannelModel::AbsoluteTable& ChannelModel::AbsoluteTableFor(const int low, const int high)
+{
+   try {
+      /* controls mostly share a handful of ranges, so tables are interned and never freed. The
+       * number of distinct 7-bit ranges bounds the pool */
+      static std::mutex pool_mutex;
+      static std::map<std::pair<int, int>, std::unique_ptr<AbsoluteTable>> pool;
+      Expects(low < high);
+      auto lock {std::scoped_lock(pool_mutex)};
+      auto& table {pool[{low, high}]};
+      if (!table) {
+         table = std::make_unique<AbsoluteTable>();
+         for (size_t value {0}; value < table->size(); ++value)
+#pragma warning(suppress : 26451) /* int subtraction won't overflow 4 bytes here */
+            table->at(value) = static_cast<double>(gsl::narrow_cast<int>(value) - low)
+                               / static_cast<double>(high - low);
+      }
+      return *table;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+const ChannelModel::ControlConfig& ChannelModel::ConfigFor(
+    const Config& config, const int controlnumber)
+{
+   try {
+      Expects(controlnumber <= kMaxNrpn && controlnumber >= 0);
+      if (controlnumber <= kMaxMidi)
+         return config.cc.at(controlnumber);
+      const auto found {std::lower_bound(config.nrpn.begin(), config.nrpn.end(), controlnumber,
+          [](const auto& entry, int number) { return entry.first < number; })};
+      if (found != config.nrpn.end() && found->first == controlnumber)
+         return found->second;
+      return config.nrpn_default;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+ChannelModel::ControlConfig& ChannelModel::MutableConfigFor(
+    Config& config, const int controlnumber)
+{
+   try {
+      Expects(controlnumber <= kMaxNrpn && controlnumber >= 0);
+      if (controlnumber <= kMaxMidi)
+         return config.cc.at(controlnumber);
+      auto found {std::lower_bound(config.nrpn.begin(), config.nrpn.end(), controlnumber,
+          [](const auto& entry, int number) { return entry.first < number; })};
+      if (found == config.nrpn.end() || found->first != controlnumber)
+         found = config.nrpn.emplace(found, controlnumber, config.nrpn_default);
+      return found->second;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+ChannelModel::Config ChannelModel::DefaultConfig()
+{
+   try {
+      Config config {};
+      const auto* const full_range {&AbsoluteTableFor(0, kMaxMidi)};
+      for (auto& control : config.cc) {
+         control.high = kMaxMidi;
+         control.table = full_range;
+      }
+      return config;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+void ChannelModel::RebuildTable(ControlConfig& control, const int controlnumber)
+{
+   try {
+      /* a relative control may be switched to absolute before its range is fixed up, so only
+       * valid ranges get a table */
+      if (controlnumber <= kMaxMidi && control.method == rsj::CCmethod::kAbsolute
+          && control.low < control.high)
+         control.table = &AbsoluteTableFor(control.low, control.high);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+std::atomic<int>& ChannelModel::CurrentFor(const int controlnumber)
+{
+   try {
+      if (!IsNrpn(controlnumber))
+         return cc_state_.at(controlnumber).current;
+      return SlotFor(controlnumber).current;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+ChannelModel::NrpnSlot& ChannelModel::SlotFor(const int controlnumber)
+{
+   try {
+      for (auto i {NrpnSlotFor(controlnumber)}, probes {size_t {0}}; probes < kNrpnSlots;
+           i = (i + 1) & (kNrpnSlots - 1), ++probes) {
+         auto& slot {nrpn_slots_.at(i)};
+         auto key {slot.key.load(std::memory_order_acquire)};
+         /* empty slots already hold the default center, so claiming one needs no further setup */
+         if (key == kEmptySlot
+             && slot.key.compare_exchange_strong(
+                 key, controlnumber, std::memory_order_acq_rel, std::memory_order_acquire))
+            return slot;
+         if (key == controlnumber)
+            return slot;
+      }
+      if (!overflow_logged_.exchange(true, std::memory_order_relaxed))
+         rsj::Log(fmt::format(FMT_STRING("ChannelModel NRPN table full, {} slots. Control {} "
+                                         "and later ones share one slot."),
+             kNrpnSlots, controlnumber));
+      return nrpn_overflow_;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+template<typename F> void ChannelModel::Edit(F&& edit)
+{
+   try {
+      auto lock {std::scoped_lock(edit_mutex_)};
+      auto config {std::make_unique<Config>(*Snapshot())};
+      std::forward<F>(edit)(*config);
+      Publish(std::move(config));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::Publish(ConfigPtr config)
+{
+   try {
+      /* caller holds edit_mutex_. readers may still be using the previous one, so it is retired
+       * rather than freed. Edits happen on the message thread, which also frees the old ones */
+      const auto now {std::chrono::steady_clock::now()};
+      retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                         [now](const Retired& r) { return now - r.retired > kRetiredGrace; }),
+          retired_.end());
+      if (current_)
+         retired_.push_back({std::move(current_), now});
+      current_ = std::move(config);
+      config_.store(current_.get(), std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+double ChannelModel::OffsetResult(
+    const int diff, const int high_limit, std::atomic<int>& current, bool const wrap)
 {
    try {
-      const auto high_limit {cc_high_.at(controlnumber)};
       Expects(diff <= high_limit && diff >= -high_limit);
-      auto cached_v {current_v_.at(controlnumber).load(std::memory_order_acquire)};
+      auto cached_v {current.load(std::memory_order_acquire)};
       int new_v {};
       if (wrap) {
          new_v = cached_v + diff;
@@ -38,9 +289,8 @@ double ChannelModel::OffsetResult(const int diff, const int controlnumber, bool
       }
       else
          [[likely]] new_v = std::clamp(cached_v + diff, 0, high_limit);
-      if (current_v_.at(controlnumber)
-              .compare_exchange_strong(
-                  cached_v, new_v, std::memory_order_release, std::memory_order_acquire))
+      if (current.compare_exchange_strong(
+              cached_v, new_v, std::memory_order_release, std::memory_order_acquire))
          return static_cast<double>(new_v) / static_cast<double>(high_limit);
       /* someone else got to change the value first, use theirs to be consistent � cached_v updated
        * by exchange */
@@ -56,13 +306,12 @@ double ChannelModel::ControllerToPlugin(
     const rsj::MessageType controltype, const int controlnumber, const int value, const bool wrap)
 {
    try {
-      Expects(controltype == rsj::MessageType::kCc
-                      && cc_method_.at(controlnumber) == rsj::CCmethod::kAbsolute
-                  ? cc_low_.at(controlnumber) < cc_high_.at(controlnumber)
+      const auto config {Snapshot()};
+      Expects(controltype == rsj::MessageType::kPw
+                  ? config->pitch_wheel_max > config->pitch_wheel_min
                   : 1);
-      Expects(controltype == rsj::MessageType::kPw ? pitch_wheel_max_ > pitch_wheel_min_ : 1);
       Expects(controltype == rsj::MessageType::kPw
-                  ? value >= pitch_wheel_min_ && value <= pitch_wheel_max_
+                  ? value >= config->pitch_wheel_min && value <= config->pitch_wheel_max
                   : 1);
       /* note that the value is not msb,lsb, but rather the calculated value. Since lsb is only 7
        * bits, high bits are shifted one right when placed into int. */
@@ -70,33 +319,44 @@ double ChannelModel::ControllerToPlugin(
       case rsj::MessageType::kPw:
          pitch_wheel_current_.store(value, std::memory_order_release);
 #pragma warning(suppress : 26451) /* int subtraction won't overflow 4 bytes here */
-         return static_cast<double>(value - pitch_wheel_min_)
-                / static_cast<double>(pitch_wheel_max_ - pitch_wheel_min_);
-      case rsj::MessageType::kCc:
-         switch (cc_method_.at(controlnumber)) {
+         return static_cast<double>(value - config->pitch_wheel_min)
+                / static_cast<double>(config->pitch_wheel_max - config->pitch_wheel_min);
+      case rsj::MessageType::kCc: {
+         if (!IsNrpn(controlnumber)) {
+            /* 7-bit inputs are looked up rather than calculated */
+            Expects(value >= 0 && value <= kMaxMidi);
+#pragma warning(suppress : 26446 26482) /* controlnumber checked by IsNrpn */
+            const auto& control {config->cc[static_cast<size_t>(controlnumber)]};
+#pragma warning(suppress : 26446 26482) /* controlnumber checked by IsNrpn */
+            auto& current {cc_state_[static_cast<size_t>(controlnumber)].current};
+            if (control.method == rsj::CCmethod::kAbsolute) {
+               current.store(value, std::memory_order_release);
+#pragma warning(suppress : 26446 26482) /* value checked above */
+               return (*control.table)[static_cast<size_t>(value)];
+            }
+            return OffsetResult(DecodeDelta(control.method, value), control.high, current, wrap);
+         }
+         const auto& control {ConfigFor(*config, controlnumber)};
+         Expects(control.method == rsj::CCmethod::kAbsolute ? control.low < control.high : 1);
+         auto& current {CurrentFor(controlnumber)};
+         switch (control.method) {
          case rsj::CCmethod::kAbsolute:
-            current_v_.at(controlnumber).store(value, std::memory_order_release);
+            current.store(value, std::memory_order_release);
 #pragma warning(suppress : 26451) /* int subtraction won't overflow 4 bytes here */
-            return static_cast<double>(value - cc_low_.at(controlnumber))
-                   / static_cast<double>(cc_high_.at(controlnumber) - cc_low_.at(controlnumber));
+            return static_cast<double>(value - control.low)
+                   / static_cast<double>(control.high - control.low);
          case rsj::CCmethod::kBinaryOffset:
-            if (IsNrpn(controlnumber))
-               return OffsetResult(value - kBit14, controlnumber, wrap);
-            return OffsetResult(value - kBit7, controlnumber, wrap);
+            return OffsetResult(value - kBit14, control.high, current, wrap);
          case rsj::CCmethod::kSignMagnitude:
-            if (IsNrpn(controlnumber))
-               return OffsetResult(
-                   value & kBit14 ? -(value & kLow13Bits) : value, controlnumber, wrap);
-            return OffsetResult(value & kBit7 ? -(value & kLow6Bits) : value, controlnumber, wrap);
+            return OffsetResult(
+                value & kBit14 ? -(value & kLow13Bits) : value, control.high, current, wrap);
          case rsj::CCmethod::kTwosComplement:
             /* SEE:https://en.wikipedia.org/wiki/Signed_number_representations#Two.27s_complement
              * flip twos comp and subtract--independent of processor architecture */
-            if (IsNrpn(controlnumber))
-               return OffsetResult(
-                   value & kBit14 ? -((value ^ kMaxNrpn) + 1) : value, controlnumber, wrap);
             return OffsetResult(
-                value & kBit7 ? -((value ^ kMaxMidi) + 1) : value, controlnumber, wrap);
+                value & kBit14 ? -((value ^ kMaxNrpn) + 1) : value, control.high, current, wrap);
          }
+      }
       case rsj::MessageType::kNoteOn:
          return static_cast<double>(value)
                 / static_cast<double>((IsNrpn(controlnumber) ? kMaxNrpn : kMaxMidi));
@@ -122,23 +382,51 @@ double ChannelModel::ControllerToPlugin(
    }
 }
 
+void ChannelModel::ControllerToPluginBatch(
+    gsl::span<const rsj::MidiMessage> messages, const bool wrap, gsl::span<double> results)
+{
+   try {
+      const auto config {Snapshot()};
+      for (size_t i {0}; i < messages.size(); ++i) {
+         const auto& mm {messages[i]};
+         if (mm.message_type_byte == rsj::MessageType::kCc && !IsNrpn(mm.control_number)
+             && mm.value >= 0 && mm.value <= kMaxMidi) {
+            const auto& control {config->cc.at(mm.control_number)};
+            if (control.method == rsj::CCmethod::kAbsolute) {
+               cc_state_.at(mm.control_number).current.store(mm.value, std::memory_order_release);
+               results[i] = control.table->at(mm.value);
+               continue;
+            }
+         }
+         results[i] = ControllerToPlugin(mm.message_type_byte, mm.control_number, mm.value, wrap);
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 /* Note: rounding up on set to center (adding remainder of %2) to center the control's LED when
  * centered */
 int ChannelModel::SetToCenter(const rsj::MessageType controltype, const int controlnumber)
 {
    try {
+      const auto config {Snapshot()};
       auto retval {0};
       switch (controltype) {
       case rsj::MessageType::kPw:
-         retval = CenterPw();
+         retval = CenterPw(*config);
          pitch_wheel_current_.store(retval, std::memory_order_release);
          break;
-      case rsj::MessageType::kCc:
-         if (cc_method_.at(controlnumber) == rsj::CCmethod::kAbsolute) {
-            retval = CenterCc(controlnumber);
-            current_v_.at(controlnumber).store(retval, std::memory_order_release);
+      case rsj::MessageType::kCc: {
+         const auto& control {ConfigFor(*config, controlnumber)};
+         if (control.method == rsj::CCmethod::kAbsolute) {
+            retval = CenterCc(control);
+            CurrentFor(controlnumber).store(retval, std::memory_order_release);
          }
          break;
+      }
       case rsj::MessageType::kChanPressure:
       case rsj::MessageType::kKeyPressure:
       case rsj::MessageType::kNoteOff:
@@ -159,13 +447,12 @@ int ChannelModel::MeasureChange(
     const rsj::MessageType controltype, const int controlnumber, const int value)
 {
    try {
-      Expects(controltype == rsj::MessageType::kCc
-                      && cc_method_.at(controlnumber) == rsj::CCmethod::kAbsolute
-                  ? cc_low_.at(controlnumber) < cc_high_.at(controlnumber)
+      const auto config {Snapshot()};
+      Expects(controltype == rsj::MessageType::kPw
+                  ? config->pitch_wheel_max > config->pitch_wheel_min
                   : 1);
-      Expects(controltype == rsj::MessageType::kPw ? pitch_wheel_max_ > pitch_wheel_min_ : 1);
       Expects(controltype == rsj::MessageType::kPw
-                  ? value >= pitch_wheel_min_ && value <= pitch_wheel_max_
+                  ? value >= config->pitch_wheel_min && value <= config->pitch_wheel_max
                   : 1);
       /* note that the value is not msb,lsb, but rather the calculated value. Since lsb is only 7
        * bits, high bits are shifted one right when placed into int. */
@@ -173,25 +460,30 @@ int ChannelModel::MeasureChange(
       case rsj::MessageType::kPw: {
          return value - pitch_wheel_current_.exchange(value, std::memory_order_acq_rel);
       }
-      case rsj::MessageType::kCc:
-         switch (cc_method_.at(controlnumber)) {
+      case rsj::MessageType::kCc: {
+         const auto& control {ConfigFor(*config, controlnumber)};
+         Expects(control.method == rsj::CCmethod::kAbsolute ? control.low < control.high : 1);
+         if (control.method == rsj::CCmethod::kAbsolute)
+            return value
+                   - CurrentFor(controlnumber).exchange(value, std::memory_order_acq_rel);
+         if (!IsNrpn(controlnumber)) {
+            Expects(value >= 0 && value <= kMaxMidi);
+            return DecodeDelta(control.method, value);
+         }
+         switch (control.method) {
          case rsj::CCmethod::kAbsolute:
-            return value - current_v_.at(controlnumber).exchange(value, std::memory_order_acq_rel);
+            break; /* handled above */
          case rsj::CCmethod::kBinaryOffset:
-            if (IsNrpn(controlnumber))
-               return value - kBit14;
-            return value - kBit7;
+            return value - kBit14;
          case rsj::CCmethod::kSignMagnitude:
-            if (IsNrpn(controlnumber))
-               return value & kBit14 ? -(value & kLow13Bits) : value;
-            return value & kBit7 ? -(value & kLow6Bits) : value;
+            return value & kBit14 ? -(value & kLow13Bits) : value;
          case rsj::CCmethod::kTwosComplement:
             /* SEE:https://en.wikipedia.org/wiki/Signed_number_representations#Two.27s_complement
              * flip twos comp and subtract--independent of processor architecture */
-            if (IsNrpn(controlnumber))
-               return value & kBit14 ? -((value ^ kMaxNrpn) + 1) : value;
-            return value & kBit7 ? -((value ^ kMaxMidi) + 1) : value;
+            return value & kBit14 ? -((value ^ kMaxNrpn) + 1) : value;
          }
+         break;
+      }
       case rsj::MessageType::kNoteOff:
       case rsj::MessageType::kNoteOn:
          return int {0};
@@ -215,30 +507,171 @@ int ChannelModel::MeasureChange(
    }
 }
 
+namespace {
+   /* Lightroom's own pickup threshold was 0.03 of the range, about 4/127 */
+   constexpr auto kPickupThreshold {0.03};
+   /* echoes of a control's own recent moves don't drop it, as the Lua pickup allowed */
+   constexpr std::int64_t kPickupHoldMs {500};
+
+   [[nodiscard]] std::int64_t SteadyMs() noexcept
+   {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+   }
+
+   [[nodiscard]] int PickupThreshold(const int range) noexcept
+   {
+      return std::max(1, static_cast<int>(std::lrint(kPickupThreshold * range)));
+   }
+} // namespace
+
+ChannelModel::Pickup& ChannelModel::PickupFor(
+    const rsj::MessageType controltype, const int controlnumber)
+{
+   try {
+      if (controltype == rsj::MessageType::kPw)
+         return pitch_wheel_pickup_;
+      if (!IsNrpn(controlnumber))
+         return cc_state_.at(controlnumber).pickup;
+      return SlotFor(controlnumber).pickup;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::NoteLrValue(Pickup& pickup, const int value, const int range)
+{
+   try {
+      pickup.lr_value.store(value, std::memory_order_release);
+      pickup.reported.store(SteadyMs(), std::memory_order_release);
+      const auto position {pickup.position.load(std::memory_order_acquire)};
+      if ((position == kUnknown || std::abs(value - position) > PickupThreshold(range))
+          && SteadyMs() - pickup.moved.load(std::memory_order_acquire) > kPickupHoldMs)
+         pickup.picked_up.store(false, std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+/* relative controls and controls Lightroom never reports on always pass */
+bool ChannelModel::PickupAllows(
+    const rsj::MessageType controltype, const int controlnumber, const int value)
+{
+   try {
+      const auto config {Snapshot()};
+      auto range {0};
+      if (controltype == rsj::MessageType::kPw)
+         range = config->pitch_wheel_max - config->pitch_wheel_min;
+      else if (controltype == rsj::MessageType::kCc) {
+         const auto& control {ConfigFor(*config, controlnumber)};
+         if (control.method != rsj::CCmethod::kAbsolute)
+            return true;
+         range = control.high - control.low;
+      }
+      else
+         return true;
+      auto& pickup {PickupFor(controltype, controlnumber)};
+      const auto previous {pickup.position.exchange(value, std::memory_order_acq_rel)};
+      auto allow {pickup.picked_up.load(std::memory_order_acquire)};
+      if (!allow) {
+         const auto lr_value {pickup.lr_value.load(std::memory_order_acquire)};
+         allow = lr_value == kUnknown || std::abs(value - lr_value) <= PickupThreshold(range)
+                 || (previous != kUnknown && (previous < lr_value) != (value < lr_value));
+         if (allow)
+            pickup.picked_up.store(true, std::memory_order_release);
+      }
+      if (allow)
+         pickup.moved.store(SteadyMs(), std::memory_order_release);
+      return allow;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+/* a motorized control reports the position Lightroom's value just drove it to. Lightroom already
+ * has that value, so it is dropped and the control counts as picked up */
+bool ChannelModel::IsEcho(const rsj::MessageType controltype, const int controlnumber,
+    const int value, const int window_ms)
+{
+   try {
+      if (controltype == rsj::MessageType::kCc) {
+         if (ConfigFor(*Snapshot(), controlnumber).method != rsj::CCmethod::kAbsolute)
+            return false;
+      }
+      else if (controltype != rsj::MessageType::kPw)
+         return false;
+      auto& pickup {PickupFor(controltype, controlnumber)};
+      if (value != pickup.lr_value.load(std::memory_order_acquire)
+          || SteadyMs() - pickup.reported.load(std::memory_order_acquire) > window_ms)
+         return false;
+      pickup.position.store(value, std::memory_order_release);
+      pickup.picked_up.store(true, std::memory_order_release);
+      return true;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+/* values that stay within the control's deadband of the current value are jitter from a resting
+ * fader or pot. The ends of the range always pass so the control can still reach them */
+bool ChannelModel::InDeadband(
+    const rsj::MessageType controltype, const int controlnumber, const int value)
+{
+   try {
+      if (controltype != rsj::MessageType::kCc)
+         return false;
+      const auto config {Snapshot()};
+      const auto& control {ConfigFor(*config, controlnumber)};
+      if (control.deadband == 0 || control.method != rsj::CCmethod::kAbsolute
+          || value <= control.low || value >= control.high)
+         return false;
+      return std::abs(value - CurrentFor(controlnumber).load(std::memory_order_acquire))
+             <= control.deadband;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 #pragma warning(push)
 #pragma warning(disable : 26451) /* see TODO below */
 int ChannelModel::PluginToController(
     const rsj::MessageType controltype, const int controlnumber, const double value)
 {
    try {
+      const auto config {Snapshot()};
       /* value effectively clamped to 0-1 by clamp calls below */
       switch (controltype) {
       case rsj::MessageType::kPw: {
          /* TODO(C26451): int subtraction: can it overflow? */
-         const auto newv {
-             std::clamp(gsl::narrow<int>(std::lrint(value * (pitch_wheel_max_ - pitch_wheel_min_)))
-                            + pitch_wheel_min_,
-                 pitch_wheel_min_, pitch_wheel_max_)};
+         const auto pw_min {config->pitch_wheel_min};
+         const auto pw_max {config->pitch_wheel_max};
+         const auto newv {std::clamp(
+             gsl::narrow<int>(std::lrint(value * (pw_max - pw_min))) + pw_min, pw_min, pw_max)};
          pitch_wheel_current_.store(newv, std::memory_order_release);
+         NoteLrValue(pitch_wheel_pickup_, newv, pw_max - pw_min);
          return newv;
       }
       case rsj::MessageType::kCc: {
          /* TODO(C26451): int subtraction: can it overflow? */
-         const auto clow {cc_low_.at(controlnumber)};
-         const auto chigh {cc_high_.at(controlnumber)};
+         const auto& control {ConfigFor(*config, controlnumber)};
+         const auto clow {control.low};
+         const auto chigh {control.high};
          const auto newv {
              std::clamp(gsl::narrow<int>(std::lrint(value * (chigh - clow))) + clow, clow, chigh)};
-         current_v_.at(controlnumber).store(newv, std::memory_order_release);
+         CurrentFor(controlnumber).store(newv, std::memory_order_release);
+         if (control.method == rsj::CCmethod::kAbsolute)
+            NoteLrValue(PickupFor(controltype, controlnumber), newv, chigh - clow);
          return newv;
       }
       case rsj::MessageType::kNoteOn:
@@ -265,14 +698,50 @@ int ChannelModel::PluginToController(
 }
 #pragma warning(pop)
 
-void ChannelModel::SetCc(
-    const int controlnumber, const int min, const int max, const rsj::CCmethod controltype)
+void ChannelModel::PluginToControllerBatch(gsl::span<const rsj::MidiMessageId> msg_ids,
+    gsl::span<const double> values, gsl::span<int> results)
 {
    try {
-      /* CcMethod has to be set before others or ranges won't be correct */
-      SetCcMethod(controlnumber, controltype);
-      SetCcMin(controlnumber, min);
-      SetCcMax(controlnumber, max);
+      /* absolute 7-bit CCs, nearly all of a refresh, are gathered and scaled together in chunks.
+       * Everything else takes the scalar path */
+      constexpr size_t kChunk {64};
+      std::array<double, kChunk> gathered_values {};
+      std::array<double, kChunk> ranges {};
+      std::array<int, kChunk> lows {};
+      std::array<int, kChunk> scaled {};
+      std::array<size_t, kChunk> positions {};
+      size_t count {0};
+      const auto flush {[&] {
+         ScaleToRange(gsl::span(gathered_values).first(count), gsl::span(ranges).first(count),
+             gsl::span(lows).first(count), gsl::span(scaled).first(count));
+         for (size_t k {0}; k < count; ++k) {
+            const auto position {positions.at(k)};
+            const auto controlnumber {msg_ids[position].control_number};
+            results[position] = scaled.at(k);
+            cc_state_.at(controlnumber).current.store(scaled.at(k), std::memory_order_release);
+            NoteLrValue(cc_state_.at(controlnumber).pickup, scaled.at(k),
+                gsl::narrow_cast<int>(ranges.at(k)));
+         }
+         count = 0;
+      }};
+      const auto config {Snapshot()};
+      for (size_t i {0}; i < msg_ids.size(); ++i) {
+         const auto& msg_id {msg_ids[i]};
+         if (msg_id.msg_id_type == rsj::MessageType::kCc && !IsNrpn(msg_id.control_number)) {
+            const auto& control {config->cc.at(msg_id.control_number)};
+            if (control.method == rsj::CCmethod::kAbsolute) {
+               gathered_values.at(count) = values[i];
+               ranges.at(count) = static_cast<double>(control.high - control.low);
+               lows.at(count) = control.low;
+               positions.at(count) = i;
+               if (++count == kChunk)
+                  flush();
+               continue;
+            }
+         }
+         results[i] = PluginToController(msg_id.msg_id_type, msg_id.control_number, values[i]);
+      }
+      flush();
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -280,33 +749,158 @@ void ChannelModel::SetCc(
    }
 }
 
-void ChannelModel::SetCcAll(
-    const int controlnumber, const int min, const int max, const rsj::CCmethod controltype)
+void ChannelModel::SetControl(ControlConfig& control, const int limit, const int min,
+    const int max, const rsj::CCmethod method)
+{
+   try {
+      /* CcMethod has to be set before others or ranges won't be correct */
+      control.method = method;
+      SetControlMin(control, min);
+      SetControlMax(control, limit, max);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+void ChannelModel::SetControlDeadband(ControlConfig& control, const int value)
 {
    try {
-      if (IsNrpn(controlnumber))
-         for (auto a {kMaxMidi + 1}; a <= kMaxNrpn; ++a) SetCc(a, min, max, controltype);
+      if (control.method != rsj::CCmethod::kAbsolute)
+         control.deadband = 0;
       else
-         for (auto a {0}; a <= kMaxMidi; ++a) SetCc(a, min, max, controltype);
+         control.deadband = std::clamp(value, 0, (control.high - control.low) / 2);
    }
    catch (const std::exception& e) {
-      MIDI2LR_E_RESPONSE;
+      MIDI2LR_E_RESPONSE_F;
       throw;
    }
 }
 
-void ChannelModel::SetCcMax(const int controlnumber, const int value)
+void ChannelModel::SetControlMax(ControlConfig& control, const int limit, const int value)
 {
    try {
       Expects(value <= kMaxNrpn && value >= 0);
-      if (cc_method_.at(controlnumber) != rsj::CCmethod::kAbsolute)
-         cc_high_.at(controlnumber) = value < 0 ? 1000 : value;
+      if (control.method != rsj::CCmethod::kAbsolute)
+         control.high = value < 0 ? 1000 : value;
+      else
+         control.high = value <= control.low || value > limit ? limit : value;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+void ChannelModel::SetControlMin(ControlConfig& control, const int value)
+{
+   try {
+      if (control.method != rsj::CCmethod::kAbsolute)
+         control.low = 0;
+      else
+         control.low = value < 0 || value >= control.high ? 0 : value;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+void ChannelModel::SetCc(
+    const int controlnumber, const int min, const int max, const rsj::CCmethod controltype)
+{
+   try {
+      auto center {0};
+      Edit([&](Config& config) {
+         auto& control {MutableConfigFor(config, controlnumber)};
+         SetControl(control, IsNrpn(controlnumber) ? kMaxNrpn : kMaxMidi, min, max, controltype);
+         RebuildTable(control, controlnumber);
+         center = CenterCc(control);
+      });
+      CurrentFor(controlnumber).store(center, std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::SetCcAll(const int controlnumber, const int min, const int max,
+    const rsj::CCmethod controltype, const int deadband)
+{
+   try {
+      if (IsNrpn(controlnumber)) {
+         auto center {0};
+         Edit([&](Config& config) {
+            config.nrpn.clear();
+            SetControl(config.nrpn_default, kMaxNrpn, min, max, controltype);
+            SetControlDeadband(config.nrpn_default, deadband);
+            center = CenterCc(config.nrpn_default);
+         });
+         /* unclaimed slots hold the default center too, so later claims start there */
+         for (auto& slot : nrpn_slots_) slot.current.store(center, std::memory_order_release);
+         nrpn_overflow_.current.store(center, std::memory_order_release);
+      }
       else {
-         const auto max {IsNrpn(controlnumber) ? kMaxNrpn : kMaxMidi};
-         cc_high_.at(controlnumber) =
-             value <= cc_low_.at(controlnumber) || value > max ? max : value;
+         auto center {0};
+         Edit([&](Config& config) {
+            for (auto a {0}; a <= kMaxMidi; ++a) {
+               auto& control {config.cc.at(a)};
+               SetControl(control, kMaxMidi, min, max, controltype);
+               SetControlDeadband(control, deadband);
+               RebuildTable(control, a);
+            }
+            center = CenterCc(config.cc.front());
+         });
+         for (auto& state : cc_state_) state.current.store(center, std::memory_order_release);
       }
-      current_v_.at(controlnumber).store(CenterCc(controlnumber), std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::SetCcDeadband(const int controlnumber, const int value)
+{
+   try {
+      Edit([&](Config& config) {
+         SetControlDeadband(MutableConfigFor(config, controlnumber), value);
+      });
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::SetCcMax(const int controlnumber, const int value)
+{
+   try {
+      auto center {0};
+      Edit([&](Config& config) {
+         auto& control {MutableConfigFor(config, controlnumber)};
+         SetControlMax(control, IsNrpn(controlnumber) ? kMaxNrpn : kMaxMidi, value);
+         RebuildTable(control, controlnumber);
+         center = CenterCc(control);
+      });
+      CurrentFor(controlnumber).store(center, std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::SetCcMethod(const int controlnumber, const rsj::CCmethod value)
+{
+   try {
+      Edit([&](Config& config) {
+         auto& control {MutableConfigFor(config, controlnumber)};
+         control.method = value;
+         RebuildTable(control, controlnumber);
+      });
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -317,11 +911,14 @@ void ChannelModel::SetCcMax(const int controlnumber, const int value)
 void ChannelModel::SetCcMin(const int controlnumber, const int value)
 {
    try {
-      if (cc_method_.at(controlnumber) != rsj::CCmethod::kAbsolute)
-         cc_low_.at(controlnumber) = 0;
-      else
-         cc_low_.at(controlnumber) = value < 0 || value >= cc_high_.at(controlnumber) ? 0 : value;
-      current_v_.at(controlnumber).store(CenterCc(controlnumber), std::memory_order_release);
+      auto center {0};
+      Edit([&](Config& config) {
+         auto& control {MutableConfigFor(config, controlnumber)};
+         SetControlMin(control, value);
+         RebuildTable(control, controlnumber);
+         center = CenterCc(control);
+      });
+      CurrentFor(controlnumber).store(center, std::memory_order_release);
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -329,30 +926,96 @@ void ChannelModel::SetCcMin(const int controlnumber, const int value)
    }
 }
 
-void ChannelModel::SetPwMax(const int value) noexcept
+void ChannelModel::SetPwMax(const int value)
 {
-   pitch_wheel_max_ = value > kMaxNrpn || value <= pitch_wheel_min_ ? kMaxNrpn : value;
-   pitch_wheel_current_.store(CenterPw(), std::memory_order_release);
+   try {
+      auto center {0};
+      Edit([&](Config& config) {
+         config.pitch_wheel_max =
+             value > kMaxNrpn || value <= config.pitch_wheel_min ? kMaxNrpn : value;
+         center = CenterPw(config);
+      });
+      pitch_wheel_current_.store(center, std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
 }
 
-void ChannelModel::SetPwMin(const int value) noexcept
+void ChannelModel::SetPwMin(const int value)
 {
-   pitch_wheel_min_ = value < 0 || value >= pitch_wheel_max_ ? 0 : value;
-   pitch_wheel_current_.store(CenterPw(), std::memory_order_release);
+   try {
+      auto center {0};
+      Edit([&](Config& config) {
+         config.pitch_wheel_min = value < 0 || value >= config.pitch_wheel_max ? 0 : value;
+         center = CenterPw(config);
+      });
+      pitch_wheel_current_.store(center, std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::SetTouchNote(const int value)
+{
+   try {
+      Edit([value](Config& config) {
+         config.touch_note = value < 0 || value > kMaxMidi ? kUnknown : value;
+      });
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+/* called when a fader is let go after feedback to it was held. Restamps the value as sent so
+ * the fader's echo of it is recognized */
+int ChannelModel::TakePwFeedback()
+{
+   try {
+      const auto value {pitch_wheel_pickup_.lr_value.load(std::memory_order_acquire)};
+      if (value != kUnknown)
+         pitch_wheel_pickup_.reported.store(SteadyMs(), std::memory_order_release);
+      return value;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
 }
 
 void ChannelModel::ActiveToSaved() const
 {
    try {
+      const auto config {Snapshot()};
       settings_to_save_.clear();
-      for (auto i {0}; i <= kMaxMidi; ++i)
-         if (cc_method_.at(i) != rsj::CCmethod::kAbsolute || cc_high_.at(i) != kMaxMidi
-             || cc_low_.at(i) != 0)
-            settings_to_save_.emplace_back(i, cc_low_.at(i), cc_high_.at(i), cc_method_.at(i));
-      for (auto i {kMaxMidi + 1}; i <= kMaxNrpn; ++i)
-         if (cc_method_.at(i) != rsj::CCmethod::kAbsolute || cc_high_.at(i) != kMaxNrpn
-             || cc_low_.at(i) != 0)
-            settings_to_save_.emplace_back(i, cc_low_.at(i), cc_high_.at(i), cc_method_.at(i));
+      for (auto i {0}; i <= kMaxMidi; ++i) {
+         const auto& control {config->cc.at(i)};
+         if (control.method != rsj::CCmethod::kAbsolute || control.high != kMaxMidi
+             || control.low != 0 || control.deadband != 0)
+            settings_to_save_.emplace_back(
+                i, control.low, control.high, control.method, control.deadband);
+      }
+      const auto& nrpn_default {config->nrpn_default};
+      if (nrpn_default.method != rsj::CCmethod::kAbsolute || nrpn_default.high != kMaxNrpn
+          || nrpn_default.low != 0 || nrpn_default.deadband != 0) {
+         /* the file format has no per-channel default, so write every NRPN as before */
+         for (auto i {kMaxMidi + 1}; i <= kMaxNrpn; ++i) {
+            const auto& control {ConfigFor(*config, i)};
+            settings_to_save_.emplace_back(
+                i, control.low, control.high, control.method, control.deadband);
+         }
+         return;
+      }
+      for (const auto& [number, control] : config->nrpn)
+         if (control.method != rsj::CCmethod::kAbsolute || control.high != kMaxNrpn
+             || control.low != 0 || control.deadband != 0)
+            settings_to_save_.emplace_back(
+                number, control.low, control.high, control.method, control.deadband);
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -360,19 +1023,30 @@ void ChannelModel::ActiveToSaved() const
    }
 }
 
-void ChannelModel::CcDefaults()
+void ChannelModel::Reset(ConfigPtr config)
 {
    try {
       /* atomics relaxed as this does not occur concurrently with other actions */
-      cc_low_.fill(0);
-      /* XCode throws linker error when use ChannelModel::kMaxNRPN here */
-      cc_high_.fill(0x3FFF);
-      cc_method_.fill(rsj::CCmethod::kAbsolute);
-      for (auto&& a : current_v_) a.store(kMaxNrpnHalf, std::memory_order_relaxed);
-      for (size_t a {0}; a <= kMaxMidi; ++a) {
-         cc_high_.at(a) = kMaxMidi;
-         current_v_.at(a).store(kMaxMidiHalf, std::memory_order_relaxed);
+      auto lock {std::scoped_lock(edit_mutex_)};
+      for (auto i {0}; i <= kMaxMidi; ++i)
+         cc_state_.at(i).current.store(CenterCc(config->cc.at(i)), std::memory_order_relaxed);
+      const auto nrpn_center {CenterCc(config->nrpn_default)};
+      for (auto& slot : nrpn_slots_) {
+         slot.key.store(kEmptySlot, std::memory_order_relaxed);
+         slot.current.store(nrpn_center, std::memory_order_relaxed);
+         /* a slot may go to a different control after this */
+         slot.pickup.position.store(kUnknown, std::memory_order_relaxed);
+         slot.pickup.lr_value.store(kUnknown, std::memory_order_relaxed);
+         slot.pickup.picked_up.store(true, std::memory_order_relaxed);
       }
+      nrpn_overflow_.current.store(nrpn_center, std::memory_order_relaxed);
+      overflow_logged_.store(false, std::memory_order_relaxed);
+      pitch_wheel_current_.store(CenterPw(*config), std::memory_order_relaxed);
+      /* configured NRPNs claim their slots now so they start from their own center */
+      for (const auto& [number, control] : config->nrpn)
+         CurrentFor(number).store(CenterCc(control), std::memory_order_relaxed);
+      Publish(std::move(config));
+      retired_.clear(); /* no readers now, see above */
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -380,12 +1054,51 @@ void ChannelModel::CcDefaults()
    }
 }
 
-void ChannelModel::SavedToActive()
+void ChannelModel::CcDefaults()
 {
    try {
-      CcDefaults();
-      for (const auto& set : settings_to_save_)
-         SetCc(set.control_number, set.low, set.high, set.method);
+      Reset(std::make_unique<const Config>(DefaultConfig()));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ChannelModel::SavedToActive(
+    const int pitch_wheel_max, const int pitch_wheel_min, const int touch_note)
+{
+   try {
+      /* build the whole configuration before publishing it once */
+      auto config {std::make_unique<Config>(DefaultConfig())};
+      config->pitch_wheel_max = pitch_wheel_max;
+      config->pitch_wheel_min = pitch_wheel_min;
+      config->touch_note = touch_note < 0 || touch_note > kMaxMidi ? kUnknown : touch_note;
+      /* a file covering the whole NRPN range came from SetCcAll. Use its most common setting as
+       * the default so only the exceptions are stored */
+      const auto nrpn_count {std::count_if(settings_to_save_.begin(), settings_to_save_.end(),
+          [this](const auto& set) { return IsNrpn(set.control_number); })};
+      if (nrpn_count == kMaxNrpn - kMaxMidi) {
+         std::map<std::tuple<rsj::CCmethod, int, int, int>, int> frequency;
+         for (const auto& set : settings_to_save_)
+            if (IsNrpn(set.control_number))
+               ++frequency[std::make_tuple(set.method, set.low, set.high, set.deadband)];
+         const auto& common {std::max_element(frequency.begin(), frequency.end(),
+             [](const auto& a, const auto& b) { return a.second < b.second; })->first};
+         SetControl(config->nrpn_default, kMaxNrpn, std::get<1>(common), std::get<2>(common),
+             std::get<0>(common));
+         SetControlDeadband(config->nrpn_default, std::get<3>(common));
+      }
+      for (const auto& set : settings_to_save_) {
+         const auto nrpn {IsNrpn(set.control_number)};
+         if (nrpn && SameConfig(ConfigFor(*config, set.control_number), set))
+            continue;
+         auto& control {MutableConfigFor(*config, set.control_number)};
+         SetControl(control, nrpn ? kMaxNrpn : kMaxMidi, set.low, set.high, set.method);
+         SetControlDeadband(control, set.deadband);
+         RebuildTable(control, set.control_number);
+      }
+      Reset(std::move(config));
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -405,4 +1118,4 @@ ChannelModel::ChannelModel()
       throw;
    }
 }
-#pragma warning(pop)
\ No newline at end of file
+#pragma warning(pop)
@@ -18,7 +18,12 @@
 //-V813_MINSIZE=13 /*warn if passing structure by value > 12 bytes (3*sizeof(int)) */
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
 #include <vector>
 
 #include <cereal/access.hpp>
@@ -26,6 +31,7 @@
 #include <cereal/types/vector.hpp>
 #include <gsl/gsl>
 
+#include "Metrics.h"
 #include "MidiUtilities.h"
 #include "Misc.h"
 
@@ -37,10 +43,11 @@ namespace rsj {
       int low {};
       int high {};
       rsj::CCmethod method {};
+      int deadband {};
       // ReSharper disable once CppNonExplicitConvertingConstructor
-      SettingsStruct(
-          int n = 0, int l = 0, int h = 0x7F, rsj::CCmethod m = rsj::CCmethod::kAbsolute) noexcept
-          : control_number {n}, low {l}, high {h}, method {m}
+      SettingsStruct(int n = 0, int l = 0, int h = 0x7F,
+          rsj::CCmethod m = rsj::CCmethod::kAbsolute, int d = 0) noexcept
+          : control_number {n}, low {l}, high {h}, method {m}, deadband {d}
       {
       }
 
@@ -53,6 +60,9 @@ namespace rsj {
          case 1:
             archive(control_number, high, low, method);
             break;
+         case 2:
+            archive(control_number, high, low, method, deadband);
+            break;
          default: {
             constexpr auto msg {
                 "The file, 'settings.xml', is marked as a version not supported by the current "
@@ -70,7 +80,8 @@ namespace rsj {
       {
          try {
             switch (version) {
-            case 1: {
+            case 1:
+            case 2: {
                std::string methodstr {"undefined"};
                switch (method) {
                case CCmethod::kAbsolute:
@@ -91,6 +102,8 @@ namespace rsj {
                }
                archive(cereal::make_nvp("CC", control_number), CEREAL_NVP(high), CEREAL_NVP(low),
                    cereal::make_nvp("method", methodstr));
+               if (version >= 2)
+                  archive(CEREAL_NVP(deadband));
                switch (methodstr.front()) {
                case 'B':
                   method = CCmethod::kBinaryOffset;
@@ -127,52 +140,120 @@ namespace rsj {
 
 class ChannelModel {
    static constexpr int kBit14 {0x2000};
-   static constexpr int kBit7 {0x40};
    static constexpr int kLow13Bits {0x1FFF};
-   static constexpr int kLow6Bits {0x3F};
    static constexpr int kMaxMidi {0x7F};
    static constexpr int kMaxMidiHalf {kMaxMidi / 2};
    static constexpr int kMaxNrpn {0x3FFF};
    static constexpr int kMaxNrpnHalf {kMaxNrpn / 2};
    static constexpr size_t kMaxControls {0x4000};
+   static constexpr int kEmptySlot {-1};
+   static constexpr int kUnknown {-1};
+   static constexpr size_t kNrpnSlots {512}; /* power of two, see NrpnSlotFor */
+   using AbsoluteTable = std::array<double, kMaxMidi + 1>;
 
  public:
    ChannelModel();
    double ControllerToPlugin(rsj::MessageType controltype, int controlnumber, int value, bool wrap);
+   void ControllerToPluginBatch(
+       gsl::span<const rsj::MidiMessage> messages, bool wrap, gsl::span<double> results);
    int MeasureChange(rsj::MessageType controltype, int controlnumber, int value);
    int SetToCenter(rsj::MessageType controltype, int controlnumber);
    [[nodiscard]] rsj::CCmethod GetCcMethod(int controlnumber) const
    {
-      return cc_method_.at(controlnumber);
+      return ConfigFor(*Snapshot(), controlnumber).method;
+   }
+   [[nodiscard]] int GetCcDeadband(int controlnumber) const
+   {
+      return ConfigFor(*Snapshot(), controlnumber).deadband;
    }
-   [[nodiscard]] int GetCcMax(int controlnumber) const { return cc_high_.at(controlnumber); }
-   [[nodiscard]] int GetCcMin(int controlnumber) const { return cc_low_.at(controlnumber); }
-   [[nodiscard]] int GetPwMax() const noexcept { return pitch_wheel_max_; }
-   [[nodiscard]] int GetPwMin() const noexcept { return pitch_wheel_min_; }
+   [[nodiscard]] int GetCcMax(int controlnumber) const
+   {
+      return ConfigFor(*Snapshot(), controlnumber).high;
+   }
+   [[nodiscard]] int GetCcMin(int controlnumber) const
+   {
+      return ConfigFor(*Snapshot(), controlnumber).low;
+   }
+   [[nodiscard]] int GetPwMax() const noexcept { return Snapshot()->pitch_wheel_max; }
+   [[nodiscard]] int GetPwMin() const noexcept { return Snapshot()->pitch_wheel_min; }
+   [[nodiscard]] int GetTouchNote() const noexcept { return Snapshot()->touch_note; }
+   [[nodiscard]] bool InDeadband(rsj::MessageType controltype, int controlnumber, int value);
+   [[nodiscard]] bool IsEcho(
+       rsj::MessageType controltype, int controlnumber, int value, int window_ms);
+   [[nodiscard]] bool PickupAllows(rsj::MessageType controltype, int controlnumber, int value);
    int PluginToController(rsj::MessageType controltype, int controlnumber, double value);
+   void PluginToControllerBatch(gsl::span<const rsj::MidiMessageId> msg_ids,
+       gsl::span<const double> values, gsl::span<int> results);
    void SetCc(int controlnumber, int min, int max, rsj::CCmethod controltype);
-   void SetCcAll(int controlnumber, int min, int max, rsj::CCmethod controltype);
+   void SetCcAll(int controlnumber, int min, int max, rsj::CCmethod controltype, int deadband);
+   void SetCcDeadband(int controlnumber, int value);
    void SetCcMax(int controlnumber, int value);
-   void SetCcMethod(int controlnumber, rsj::CCmethod value)
-   {
-      cc_method_.at(controlnumber) = value;
-   }
+   void SetCcMethod(int controlnumber, rsj::CCmethod value);
    void SetCcMin(int controlnumber, int value);
-   void SetPwMax(int value) noexcept;
-   void SetPwMin(int value) noexcept;
+   void SetPwMax(int value);
+   void SetPwMin(int value);
+   void SetTouchNote(int value);
+   int TakePwFeedback();
 
  private:
    friend class cereal::access;
-   [[nodiscard]] int CenterCc(int controlnumber) const noexcept
+   struct ControlConfig {
+      rsj::CCmethod method {rsj::CCmethod::kAbsolute};
+      int low {0};
+      int high {kMaxNrpn};
+      int deadband {0}; /* absolute only: inputs this close to the current value are dropped */
+      /* normalized value of every input for 7-bit absolute controls, see AbsoluteTableFor */
+      const AbsoluteTable* table {nullptr};
+   };
+   /* Configuration is edited on the message thread and read by the MIDI and Lightroom threads.
+    * It is never changed once published: edits copy the current snapshot, change the copy and
+    * publish it with one atomic store, so readers always see a consistent whole. A replaced
+    * configuration is kept for a grace period far longer than any reader holds a snapshot, so a
+    * snapshot is a plain pointer: one acquire load, no reference count and no lock. Retired ones
+    * are freed by later edits, and all at once by Reset */
+   struct Config {
+      std::array<ControlConfig, kMaxMidi + 1> cc {};
+      std::vector<std::pair<int, ControlConfig>> nrpn {}; /* sorted by control number */
+      ControlConfig nrpn_default {};                      /* NRPNs not in nrpn */
+      int pitch_wheel_max {kMaxNrpn};
+      int pitch_wheel_min {0};
+      int touch_note {kUnknown}; /* note a motorized pitch wheel fader sends while touched */
+   };
+   using ConfigPtr = std::unique_ptr<const Config>;
+   struct Retired {
+      ConfigPtr config;
+      std::chrono::steady_clock::time_point retired;
+   };
+   /* soft takeover for absolute controls. Once Lightroom reports a value away from where the
+    * control sits, input is held back until the control reaches or crosses that value */
+   struct Pickup {
+      std::atomic<int> position {kUnknown}; /* last input from the control */
+      std::atomic<int> lr_value {kUnknown}; /* last value from Lightroom, in control units */
+      std::atomic<std::int64_t> moved {0};  /* steady clock ms of the last input passed on */
+      std::atomic<std::int64_t> reported {0}; /* steady clock ms lr_value was last sent */
+      std::atomic<bool> picked_up {true};
+   };
+   /* current values of NRPN controls, claimed the first time a control is configured or used.
+    * Unclaimed slots hold the center of the NRPN default range */
+   struct NrpnSlot {
+      std::atomic<int> key {kEmptySlot};
+      std::atomic<int> current {kMaxNrpnHalf};
+      Pickup pickup {};
+   };
+   /* 7-bit controls are written on nearly every message, so each control's value and pickup
+    * state share one cache line and no two controls share a line */
+   struct alignas(64) CcState {
+      std::atomic<int> current {kMaxMidiHalf};
+      Pickup pickup {};
+   };
+   [[nodiscard]] static int CenterCc(const ControlConfig& control) noexcept
    {
-      return (cc_high_.at(controlnumber) - cc_low_.at(controlnumber)) / 2
-             + cc_low_.at(controlnumber)
-             + (cc_high_.at(controlnumber) - cc_low_.at(controlnumber)) % 2;
+      return (control.high - control.low) / 2 + control.low + (control.high - control.low) % 2;
    }
-   [[nodiscard]] int CenterPw() const noexcept
+   [[nodiscard]] static int CenterPw(const Config& config) noexcept
    {
-      return (pitch_wheel_max_ - pitch_wheel_min_) / 2 + pitch_wheel_min_
-             + (pitch_wheel_max_ - pitch_wheel_min_) % 2;
+      return (config.pitch_wheel_max - config.pitch_wheel_min) / 2 + config.pitch_wheel_min
+             + (config.pitch_wheel_max - config.pitch_wheel_min) % 2;
    }
    // ReSharper disable once CppMemberFunctionMayBeStatic
    [[nodiscard]] bool IsNrpn(int controlnumber) const noexcept(kNdebug)
@@ -180,23 +261,59 @@ class ChannelModel {
       Expects(controlnumber <= kMaxNrpn && controlnumber >= 0);
       return controlnumber > kMaxMidi;
    }
-   double OffsetResult(int diff, int controlnumber, bool wrap);
+   [[nodiscard]] static size_t NrpnSlotFor(int controlnumber) noexcept
+   {
+      return static_cast<size_t>(controlnumber) & (kNrpnSlots - 1);
+   }
+   [[nodiscard]] const Config* Snapshot() const noexcept
+   {
+      return config_.load(std::memory_order_acquire);
+   }
+   [[nodiscard]] static bool SameConfig(
+       const ControlConfig& a, const rsj::SettingsStruct& b) noexcept
+   {
+      return a.method == b.method && a.low == b.low && a.high == b.high
+             && a.deadband == b.deadband;
+   }
+   [[nodiscard]] static const AbsoluteTable& AbsoluteTableFor(int low, int high);
+   [[nodiscard]] static const ControlConfig& ConfigFor(const Config& config, int controlnumber);
+   [[nodiscard]] static Config DefaultConfig();
+   static ControlConfig& MutableConfigFor(Config& config, int controlnumber);
+   static void RebuildTable(ControlConfig& control, int controlnumber);
+   static void SetControl(
+       ControlConfig& control, int limit, int min, int max, rsj::CCmethod method);
+   static void SetControlDeadband(ControlConfig& control, int value);
+   static void SetControlMax(ControlConfig& control, int limit, int value);
+   static void SetControlMin(ControlConfig& control, int value);
+   std::atomic<int>& CurrentFor(int controlnumber);
+   NrpnSlot& SlotFor(int controlnumber);
+   Pickup& PickupFor(rsj::MessageType controltype, int controlnumber);
+   static void NoteLrValue(Pickup& pickup, int value, int range);
+   double OffsetResult(int diff, int high_limit, std::atomic<int>& current, bool wrap);
+   template<typename F> void Edit(F&& edit);
    void ActiveToSaved() const;
    void CcDefaults();
-   void SavedToActive();
+   void Publish(ConfigPtr config);
+   void Reset(ConfigPtr config);
+   void SavedToActive(
+       int pitch_wheel_max = kMaxNrpn, int pitch_wheel_min = 0, int touch_note = kUnknown);
    // ReSharper disable CppConstParameterInDeclaration
    template<class Archive> void load(Archive& archive, uint32_t const version);
    template<class Archive> void save(Archive& archive, uint32_t const version) const;
    // ReSharper restore CppConstParameterInDeclaration
 
    mutable std::vector<rsj::SettingsStruct> settings_to_save_ {};
-   int pitch_wheel_max_ {kMaxNrpn};
-   int pitch_wheel_min_ {0};
+   std::atomic<const Config*> config_ {nullptr}; /* current_ */
+   /* guarded by edit_mutex_ */
+   ConfigPtr current_ {};
+   std::vector<Retired> retired_ {}; /* replaced, but readers may still hold them */
+   std::mutex edit_mutex_; /* serializes writers, readers never take it */
    std::atomic<int> pitch_wheel_current_ {kMaxNrpnHalf};
-   std::array<rsj::CCmethod, kMaxControls> cc_method_ {};
-   std::array<int, kMaxControls> cc_high_ {};
-   std::array<int, kMaxControls> cc_low_ {};
-   std::array<std::atomic<int>, kMaxControls> current_v_ {};
+   Pickup pitch_wheel_pickup_ {};
+   std::array<CcState, kMaxMidi + 1> cc_state_ {};
+   std::array<NrpnSlot, kNrpnSlots> nrpn_slots_ {};
+   NrpnSlot nrpn_overflow_ {}; /* shared once the slots run out */
+   std::atomic<bool> overflow_logged_ {false};
 };
 
 class ControlsModel {
@@ -207,6 +324,20 @@ class ControlsModel {
           .ControllerToPlugin(mm.message_type_byte, mm.control_number, mm.value, wrap);
    }
 
+   /* converts a run of messages, taking each channel's configuration once. results must be the
+    * same size as messages */
+   void ControllerToPluginBatch(
+       gsl::span<const rsj::MidiMessage> messages, bool wrap, gsl::span<double> results)
+   {
+      Expects(results.size() == messages.size());
+      for (size_t first {0}, last {0}; first < messages.size(); first = last) {
+         const auto channel {messages[first].channel};
+         while (last < messages.size() && messages[last].channel == channel) ++last;
+         all_controls_.at(channel).ControllerToPluginBatch(
+             messages.subspan(first, last - first), wrap, results.subspan(first, last - first));
+      }
+   }
+
    int MeasureChange(const rsj::MidiMessage& mm)
    {
       return all_controls_.at(mm.channel)
@@ -232,6 +363,11 @@ class ControlsModel {
           .GetCcMethod(msg_id.control_number);
    }
 
+   [[nodiscard]] int GetCcDeadband(int channel, int controlnumber) const
+   {
+      return all_controls_.at(channel).GetCcDeadband(controlnumber);
+   }
+
    [[nodiscard]] int GetCcMax(int channel, int controlnumber) const
    {
       return all_controls_.at(channel).GetCcMax(controlnumber);
@@ -246,6 +382,58 @@ class ControlsModel {
 
    [[nodiscard]] int GetPwMin(int channel) const { return all_controls_.at(channel).GetPwMin(); }
 
+   [[nodiscard]] int GetTouchNote(int channel) const
+   {
+      return all_controls_.at(channel).GetTouchNote();
+   }
+
+   /* jitter filter for absolute controls; counts what it drops */
+   [[nodiscard]] bool InDeadband(const rsj::MidiMessage& mm)
+   {
+      if (all_controls_.at(mm.channel)
+              .InDeadband(mm.message_type_byte, mm.control_number, mm.value)) {
+         deadband_suppressed_.Add();
+         return true;
+      }
+      return false;
+   }
+
+   /* motorized faders report the positions they are driven to; counts what it drops */
+   [[nodiscard]] bool IsEcho(const rsj::MidiMessage& mm, int window_ms)
+   {
+      if (all_controls_.at(mm.channel)
+              .IsEcho(mm.message_type_byte, mm.control_number, mm.value, window_ms)) {
+         echo_suppressed_.Add();
+         return true;
+      }
+      return false;
+   }
+
+   /* true while the fader for msg_id is held, so feedback to it waits for release */
+   [[nodiscard]] bool IsTouched(rsj::MidiMessageId msg_id) const
+   {
+      /* MidiMessageId channel is 1-based */
+      return msg_id.msg_id_type == rsj::MessageType::kPw
+             && touched_.at(gsl::narrow_cast<size_t>(msg_id.channel) - 1)
+                    .load(std::memory_order_acquire);
+   }
+
+   [[nodiscard]] bool PickupAllows(const rsj::MidiMessage& mm)
+   {
+      return all_controls_.at(mm.channel)
+          .PickupAllows(mm.message_type_byte, mm.control_number, mm.value);
+   }
+
+   [[nodiscard]] std::uint64_t DeadbandSuppressed() const noexcept
+   {
+      return deadband_suppressed_.Get();
+   }
+
+   [[nodiscard]] std::uint64_t EchoSuppressed() const noexcept
+   {
+      return echo_suppressed_.Get();
+   }
+
    int PluginToController(rsj::MidiMessageId msg_id, double value)
    {
       /* msg_id is one-based */
@@ -253,6 +441,22 @@ class ControlsModel {
           .PluginToController(msg_id.msg_id_type, msg_id.control_number, value);
    }
 
+   /* batch form of PluginToController for refresh bursts. msg_ids, values and results must be
+    * the same size */
+   void PluginToControllerBatch(gsl::span<const rsj::MidiMessageId> msg_ids,
+       gsl::span<const double> values, gsl::span<int> results)
+   {
+      Expects(values.size() == msg_ids.size() && results.size() == msg_ids.size());
+      for (size_t first {0}, last {0}; first < msg_ids.size(); first = last) {
+         const auto channel {msg_ids[first].channel};
+         while (last < msg_ids.size() && msg_ids[last].channel == channel) ++last;
+         /* msg_id is one-based */
+         all_controls_.at(gsl::narrow_cast<size_t>(channel) - 1)
+             .PluginToControllerBatch(msg_ids.subspan(first, last - first),
+                 values.subspan(first, last - first), results.subspan(first, last - first));
+      }
+   }
+
    int MeasureChange(rsj::MessageType controltype, int channel, int controlnumber, int value)
    {
       return all_controls_.at(channel).MeasureChange(controltype, controlnumber, value);
@@ -262,9 +466,15 @@ class ControlsModel {
    {
       all_controls_.at(channel).SetCc(controlnumber, min, max, controltype);
    }
-   void SetCcAll(int channel, int controlnumber, int min, int max, rsj::CCmethod controltype)
+   void SetCcAll(int channel, int controlnumber, int min, int max, rsj::CCmethod controltype,
+       int deadband)
    {
-      all_controls_.at(channel).SetCcAll(controlnumber, min, max, controltype);
+      all_controls_.at(channel).SetCcAll(controlnumber, min, max, controltype, deadband);
+   }
+
+   void SetCcDeadband(int channel, int controlnumber, int value)
+   {
+      all_controls_.at(channel).SetCcDeadband(controlnumber, value);
    }
 
    void SetCcMax(int channel, int controlnumber, int value)
@@ -286,32 +496,100 @@ class ControlsModel {
 
    void SetPwMin(int channel, int value) { all_controls_.at(channel).SetPwMin(value); }
 
+   void SetTouchNote(int channel, int value)
+   {
+      all_controls_.at(channel).SetTouchNote(value);
+      RebuildTouchNotes();
+   }
+
+   /* Lightroom's latest pitch wheel value for a fader being released, or -1 if it has none */
+   int TakePwFeedback(int channel) { return all_controls_.at(channel).TakePwFeedback(); }
+
+   /* whether note is the touch note of channel's pitch wheel fader */
+   [[nodiscard]] bool IsTouchNote(int channel, int note) const
+   {
+      return (touch_channels_.at(note).load(std::memory_order_acquire) & 1U << channel) != 0;
+   }
+
+   /* follows touch notes. Returns a mask of the channels whose faders this message released */
+   std::uint16_t UpdateTouch(const rsj::MidiMessage& mm)
+   {
+      if (mm.message_type_byte != rsj::MessageType::kNoteOn)
+         return 0;
+      const auto channels {touch_channels_.at(mm.control_number).load(std::memory_order_acquire)};
+      std::uint16_t released {0};
+      for (size_t channel {0}; channel < touched_.size(); ++channel)
+         if (channels & 1U << channel) {
+            const auto down {mm.value != 0}; /* touch release is note on with velocity 0 */
+            if (touched_.at(channel).exchange(down, std::memory_order_acq_rel) && !down)
+               released |= gsl::narrow_cast<std::uint16_t>(1U << channel);
+         }
+      return released;
+   }
+
  private:
    friend class cereal::access;
    template<class Archive> void serialize(Archive& archive, uint32_t const version)
    {
-      if (version == 1)
+      if (version == 1) {
          archive(all_controls_);
+         RebuildTouchNotes();
+      }
+   }
+   void RebuildTouchNotes()
+   {
+      std::array<std::uint16_t, 128> masks {};
+      for (size_t channel {0}; channel < all_controls_.size(); ++channel)
+         if (const auto note {all_controls_.at(channel).GetTouchNote()}; note >= 0)
+            masks.at(note) |= gsl::narrow_cast<std::uint16_t>(1U << channel);
+      for (size_t note {0}; note < masks.size(); ++note)
+         touch_channels_.at(note).store(masks.at(note), std::memory_order_release);
+      for (auto& touched : touched_) touched.store(false, std::memory_order_release);
    }
    std::array<ChannelModel, 16> all_controls_;
+   std::array<std::atomic<bool>, 16> touched_ {};
+   /* for each note, the channels whose pitch wheel faders use it as their touch note */
+   std::array<std::atomic<std::uint16_t>, 128> touch_channels_ {};
+   rsj::Counter& deadband_suppressed_ {rsj::Metrics().GetCounter("suppressed.deadband")};
+   rsj::Counter& echo_suppressed_ {rsj::Metrics().GetCounter("suppressed.echo")};
 };
 
 template<class Archive> void ChannelModel::load(Archive& archive, uint32_t const version)
 {
    try {
       switch (version) {
-      case 1:
-         archive(cc_method_, cc_high_, cc_low_, pitch_wheel_max_, pitch_wheel_min_);
+      case 1: {
+         /* version 1 stored every control densely; keep only the ones off their defaults */
+         auto methods {std::make_unique<std::array<rsj::CCmethod, kMaxControls>>()};
+         auto highs {std::make_unique<std::array<int, kMaxControls>>()};
+         auto lows {std::make_unique<std::array<int, kMaxControls>>()};
+         int pitch_wheel_max {};
+         int pitch_wheel_min {};
+         archive(*methods, *highs, *lows, pitch_wheel_max, pitch_wheel_min);
+         settings_to_save_.clear();
+         for (auto i {0}; i <= kMaxNrpn; ++i)
+            if (methods->at(i) != rsj::CCmethod::kAbsolute
+                || highs->at(i) != (IsNrpn(i) ? kMaxNrpn : kMaxMidi) || lows->at(i) != 0)
+               settings_to_save_.emplace_back(i, lows->at(i), highs->at(i), methods->at(i));
+         SavedToActive(pitch_wheel_max, pitch_wheel_min);
          break;
+      }
       case 2:
          archive(settings_to_save_);
          SavedToActive();
          break;
       case 3:
-         archive(settings_to_save_, cereal::make_nvp("PWmax", pitch_wheel_max_),
-             cereal::make_nvp("PWmin", pitch_wheel_min_));
-         SavedToActive();
+      case 4: {
+         int pitch_wheel_max {kMaxNrpn};
+         int pitch_wheel_min {0};
+         int touch_note {kUnknown};
+         archive(settings_to_save_, cereal::make_nvp("PWmax", pitch_wheel_max),
+             cereal::make_nvp("PWmin", pitch_wheel_min));
+         if (version >= 4)
+            archive(cereal::make_nvp("TouchNote", touch_note));
+         SavedToActive(pitch_wheel_max, pitch_wheel_min, touch_note);
          break;
+      }
       default: {
          constexpr auto msg {
              "The file, 'settings.xml', is marked as a version not supported by the current "
@@ -330,18 +608,35 @@ template<class Archive> void ChannelModel::load(Archive& archive, uint32_t const
 template<class Archive> void ChannelModel::save(Archive& archive, uint32_t const version) const
 {
    try {
+      const auto config {Snapshot()};
       switch (version) {
-      case 1:
-         archive(cc_method_, cc_high_, cc_low_, pitch_wheel_max_, pitch_wheel_min_);
+      case 1: {
+         auto methods {std::make_unique<std::array<rsj::CCmethod, kMaxControls>>()};
+         auto highs {std::make_unique<std::array<int, kMaxControls>>()};
+         auto lows {std::make_unique<std::array<int, kMaxControls>>()};
+         for (auto i {0}; i <= kMaxNrpn; ++i) {
+            const auto& control {ConfigFor(*config, i)};
+            methods->at(i) = control.method;
+            highs->at(i) = control.high;
+            lows->at(i) = control.low;
+         }
+         archive(*methods, *highs, *lows, config->pitch_wheel_max, config->pitch_wheel_min);
          break;
+      }
       case 2:
          ActiveToSaved();
          archive(settings_to_save_);
          break;
       case 3:
          ActiveToSaved();
-         archive(settings_to_save_, cereal::make_nvp("PWmax", pitch_wheel_max_),
-             cereal::make_nvp("PWmin", pitch_wheel_min_));
+         archive(settings_to_save_, cereal::make_nvp("PWmax", config->pitch_wheel_max),
+             cereal::make_nvp("PWmin", config->pitch_wheel_min));
+         break;
+      case 4:
+         ActiveToSaved();
+         archive(settings_to_save_, cereal::make_nvp("PWmax", config->pitch_wheel_max),
+             cereal::make_nvp("PWmin", config->pitch_wheel_min),
+             cereal::make_nvp("TouchNote", config->touch_note));
          break;
       default: {
          constexpr auto msg {
@@ -359,8 +654,8 @@ template<class Archive> void ChannelModel::save(Archive& archive, uint32_t const
 }
 #pragma warning(push)
 #pragma warning(disable : 26426 26440 26444)
-CEREAL_CLASS_VERSION(ChannelModel, 3)
+CEREAL_CLASS_VERSION(ChannelModel, 4)
 CEREAL_CLASS_VERSION(ControlsModel, 1)
-CEREAL_CLASS_VERSION(rsj::SettingsStruct, 1)
+CEREAL_CLASS_VERSION(rsj::SettingsStruct, 2)
 #pragma warning(pop)
 #endif
\ No newline at end of file
@@ -0,0 +1,312 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "Misc.h"
+
+namespace {
+   constexpr std::size_t kTraceEvents {4096}; /* per thread, power of 2 */
+   constexpr std::size_t kNameSlots {2048};   /* power of 2, well above the command count */
+   constexpr std::size_t kNameProbes {16};
+   constexpr std::size_t kNameLength {48};
+   constexpr int kStageShift {56};
+   constexpr std::uint64_t kCommandFlag {1ULL << 55};
+   constexpr std::uint64_t kIdMask {(1ULL << kStageShift) - 1};
+   constexpr std::array kStageNames {
+       "MidiIn", "Dispatch", "Model", "SocketWrite", "LrRead", "LrProcess", "MidiOut"};
+
+   struct TraceEvent {
+      std::atomic<std::int64_t> time_ns {0};
+      std::atomic<std::uint64_t> stage_id {0}; /* stage in the top byte */
+      std::atomic<double> value {0.0};
+   };
+
+   struct TraceRing {
+      std::atomic<std::uint64_t> head {0}; /* written by the owning thread only */
+      std::array<TraceEvent, kTraceEvents> events {};
+   };
+
+   struct RingRegistry {
+      std::mutex mutex {};
+      std::vector<std::unique_ptr<TraceRing>> rings {};
+   };
+
+   /* Rings stay registered after their thread exits so its last events can still be dumped */
+   RingRegistry& Registry()
+   {
+      static RingRegistry registry {};
+      return registry;
+   }
+
+   TraceRing& ThisThreadRing()
+   {
+      thread_local TraceRing* ring {nullptr};
+      if (!ring) {
+         auto& registry {Registry()};
+         auto new_ring {std::make_unique<TraceRing>()};
+         ring = new_ring.get();
+         const std::scoped_lock lock {registry.mutex};
+         registry.rings.push_back(std::move(new_ring));
+      }
+      return *ring;
+   }
+
+   /* Command names are interned once, so the rings only carry a hash */
+   struct NameSlot {
+      std::atomic<std::uint32_t> hash {0};
+      std::atomic<bool> ready {false};
+      std::array<char, kNameLength> name {};
+   };
+
+   std::array<NameSlot, kNameSlots>& Names()
+   {
+      static std::array<NameSlot, kNameSlots> names {};
+      return names;
+   }
+
+   std::uint64_t CommandId(std::string_view command) noexcept
+   {
+      const auto hash {static_cast<std::uint32_t>(std::hash<std::string_view> {}(command)) | 1U};
+      auto& names {Names()};
+      for (std::size_t probe {0}; probe < kNameProbes; ++probe) {
+         auto& slot {names[(hash + probe) & (kNameSlots - 1)]};
+         auto seen {slot.hash.load(std::memory_order_acquire)};
+         if (seen == 0
+             && slot.hash.compare_exchange_strong(seen, hash, std::memory_order_acq_rel)) {
+            command.substr(0, kNameLength - 1).copy(slot.name.data(), kNameLength - 1);
+            slot.ready.store(true, std::memory_order_release);
+            break;
+         }
+         if (seen == hash)
+            break;
+      }
+      return kCommandFlag | hash;
+   }
+
+   std::string CommandName(std::uint32_t hash)
+   {
+      auto& names {Names()};
+      for (std::size_t probe {0}; probe < kNameProbes; ++probe) {
+         const auto& slot {names[(hash + probe) & (kNameSlots - 1)]};
+         if (slot.hash.load(std::memory_order_acquire) == hash
+             && slot.ready.load(std::memory_order_acquire))
+            return std::string(slot.name.data());
+      }
+      return fmt::format(FMT_STRING("command {:08x}"), hash);
+   }
+
+   std::uint64_t MessageId(rsj::MidiMessageId id, rsj::DeviceId device) noexcept
+   {
+      return static_cast<std::uint64_t>(device & 0xFFFF) << 32
+             | static_cast<std::uint64_t>(id.msg_id_type) << 24
+             | static_cast<std::uint64_t>(id.channel & 0xFF) << 16
+             | static_cast<std::uint64_t>(id.control_number & 0xFFFF);
+   }
+
+   std::string Describe(std::uint64_t id)
+   {
+      if (id & kCommandFlag)
+         return CommandName(static_cast<std::uint32_t>(id));
+      return fmt::format(FMT_STRING("{} ch {} #{} dev {}"),
+          rsj::MessageTypeToName(static_cast<rsj::MessageType>(id >> 24 & 0xF)), id >> 16 & 0xFF,
+          id & 0xFFFF, id >> 32 & 0xFFFF);
+   }
+
+   void Record(rsj::TraceStage stage, std::uint64_t id, double value) noexcept
+   {
+      try {
+         const auto now {std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+                             .count()};
+         auto& ring {ThisThreadRing()};
+         const auto pos {ring.head.load(std::memory_order_relaxed)};
+         auto& event {ring.events[pos & (kTraceEvents - 1)]};
+         event.time_ns.store(now, std::memory_order_relaxed);
+         event.stage_id.store(static_cast<std::uint64_t>(stage) << kStageShift | (id & kIdMask),
+             std::memory_order_relaxed);
+         event.value.store(value, std::memory_order_relaxed);
+         ring.head.store(pos + 1, std::memory_order_release);
+      }
+      catch (...) { //-V565
+      }
+   }
+
+   struct Snapshot {
+      std::int64_t time_ns;
+      std::uint64_t stage_id;
+      double value;
+   };
+
+   /* Copies a ring while its owner may still be writing to it; entries the writer may have
+    * overwritten meanwhile are discarded */
+   std::vector<Snapshot> Copy(const TraceRing& ring)
+   {
+      const auto head {ring.head.load(std::memory_order_acquire)};
+      const auto first {head > kTraceEvents ? head - kTraceEvents : 0};
+      std::vector<Snapshot> copy {};
+      copy.reserve(head - first);
+      for (auto i {first}; i < head; ++i) {
+         const auto& event {ring.events[i & (kTraceEvents - 1)]};
+         copy.push_back({event.time_ns.load(std::memory_order_relaxed),
+             event.stage_id.load(std::memory_order_relaxed),
+             event.value.load(std::memory_order_relaxed)});
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const auto later_head {ring.head.load(std::memory_order_relaxed)};
+      if (const auto valid_from {later_head >= kTraceEvents ? later_head - kTraceEvents + 1 : 0};
+          valid_from > first)
+         copy.erase(copy.begin(), copy.begin()
+                                      + gsl::narrow_cast<std::ptrdiff_t>(
+                                          std::min(valid_from - first, head - first)));
+      return copy;
+   }
+
+   std::string JsonEscape(std::string_view in)
+   {
+      std::string out {};
+      out.reserve(in.size());
+      for (const auto c : in) {
+         if (c == '"' || c == '\\')
+            out.push_back('\\');
+         if (rsj::CharToInt(c) >= 0x20 || rsj::CharToInt(c) < 0)
+            out.push_back(c);
+      }
+      return out;
+   }
+} // namespace
+
+void rsj::Trace(const TraceStage stage, const MidiMessage& mm) noexcept
+{
+   Record(stage, MessageId(MidiMessageId {mm}, mm.device), mm.value);
+}
+
+void rsj::Trace(const TraceStage stage, const MidiMessageId id, const DeviceId device,
+    const double value) noexcept
+{
+   Record(stage, MessageId(id, device), value);
+}
+
+void rsj::Trace(
+    const TraceStage stage, const std::string_view command, const double value) noexcept
+{
+   Record(stage, CommandId(command), value);
+}
+
+void rsj::TraceLine(const TraceStage stage, std::string_view line) noexcept
+{
+   rsj::Trim(line);
+   const auto delimiter {line.find_first_of(" \t")};
+   auto value {std::numeric_limits<double>::quiet_NaN()};
+   if (delimiter != std::string_view::npos) {
+      std::array<char, 32> buffer {};
+      line.substr(delimiter + 1, buffer.size() - 1).copy(buffer.data(), buffer.size() - 1);
+      char* end {nullptr};
+      if (const auto parsed {std::strtod(buffer.data(), &end)}; end != buffer.data())
+         value = parsed;
+   }
+   Record(stage, CommandId(line.substr(0, delimiter)), value);
+}
+
+bool rsj::DumpTrace(const juce::File& file) noexcept
+{
+   try {
+      std::vector<std::vector<Snapshot>> copies {};
+      {
+         auto& registry {Registry()};
+         const std::scoped_lock lock {registry.mutex};
+         for (const auto& ring : registry.rings)
+            copies.push_back(Copy(*ring));
+      }
+      auto origin {std::numeric_limits<std::int64_t>::max()};
+      for (const auto& copy : copies)
+         for (const auto& event : copy)
+            origin = std::min(origin, event.time_ns);
+      std::string out {"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"};
+      auto out_it {std::back_inserter(out)};
+      auto first {true};
+      for (std::size_t tid {0}; tid < copies.size(); ++tid) {
+         if (copies[tid].empty())
+            continue;
+         /* name each thread after the stages it recorded */
+         std::array<bool, kStageNames.size()> seen {};
+         for (const auto& event : copies[tid])
+            if (const auto stage {event.stage_id >> kStageShift}; stage < seen.size())
+               seen.at(stage) = true;
+         std::string thread_name {};
+         for (std::size_t stage {0}; stage < seen.size(); ++stage)
+            if (seen.at(stage))
+               thread_name.append(thread_name.empty() ? "" : "/").append(kStageNames.at(stage));
+         fmt::format_to(out_it,
+             FMT_STRING("{}{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":{},"
+                        "\"args\":{{\"name\":\"{}\"}}}}"),
+             first ? "" : ",\n", tid, thread_name);
+         first = false;
+         for (const auto& event : copies[tid]) {
+            const auto stage {event.stage_id >> kStageShift};
+            if (stage >= kStageNames.size())
+               continue;
+            fmt::format_to(out_it,
+                FMT_STRING(",\n{{\"ph\":\"i\",\"s\":\"t\",\"cat\":\"pipeline\",\"name\":\"{}\","
+                           "\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"args\":{{\"message\":\"{}\""),
+                kStageNames.at(stage), tid, static_cast<double>(event.time_ns - origin) / 1000.0,
+                JsonEscape(Describe(event.stage_id & kIdMask)));
+            if (event.value == event.value) /* NaN when the line had no number */
+               fmt::format_to(out_it, FMT_STRING(",\"value\":{}"), event.value);
+            out.append("}}");
+         }
+      }
+      out.append("\n]}\n");
+      if (!file.replaceWithText(out, false, false, "\n")) {
+         rsj::Log(fmt::format(FMT_STRING("Unable to write pipeline trace to {}."),
+             file.getFullPathName().toStdString()));
+         return false;
+      }
+      rsj::Log(fmt::format(
+          FMT_STRING("Pipeline trace written to {}."), file.getFullPathName().toStdString()));
+      return true;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      return false;
+   }
+}
+
+juce::File rsj::DefaultTraceFile()
+{
+   try {
+      return rsj::LogFolderFile("MIDI2LR_trace.json");
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
@@ -0,0 +1,50 @@
+#ifndef MIDI2LR_FLIGHTRECORDER_H_INCLUDED
+#define MIDI2LR_FLIGHTRECORDER_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <cstdint>
+#include <string_view>
+
+#include <juce_core/juce_core.h>
+
+#include "MidiUtilities.h"
+
+namespace rsj {
+   /* Pipeline boundaries, in the order a control change and Lightroom's reply pass them */
+   enum class TraceStage : std::uint8_t {
+      kMidiIn,      /* MidiReceiver driver callback */
+      kDispatch,    /* popped from MidiReceiver::messages_ */
+      kModel,       /* passed ControlsModel filters in LrIpcOut */
+      kSocketWrite, /* written to the LrIpcOut socket */
+      kLrRead,      /* read from the LrIpcIn socket */
+      kLrProcess,   /* converted by LrIpcIn, about to go to MidiSender */
+      kMidiOut      /* sent by MidiSender */
+   };
+
+   /* Always on. Each thread records into its own fixed-size ring, so recording is a few relaxed
+    * stores and never blocks; the oldest events are overwritten. */
+   void Trace(TraceStage stage, const MidiMessage& mm) noexcept;
+   void Trace(TraceStage stage, MidiMessageId id, DeviceId device, double value) noexcept;
+   void Trace(TraceStage stage, std::string_view command, double value) noexcept;
+   /* line is "Command value", as exchanged with the plugin */
+   void TraceLine(TraceStage stage, std::string_view line) noexcept;
+
+   /* Writes every thread's ring in Chrome trace event format (chrome://tracing, Perfetto) */
+   bool DumpTrace(const juce::File& file) noexcept;
+   [[nodiscard]] juce::File DefaultTraceFile();
+} // namespace rsj
+
+#endif
@@ -26,7 +26,12 @@
 #include <juce_audio_devices/juce_audio_devices.h> //ReSharper false alarm
 #include <juce_gui_basics/juce_gui_basics.h>
 
+#include "AllocationAccounting.h"
+#include "CommandSet.h"
 #include "ControlsModel.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "LR_IPC_Out.h"
 #include "MIDISender.h"
 #include "MidiUtilities.h"
 #include "Misc.h"
@@ -36,18 +41,36 @@
 using namespace std::literals::chrono_literals;
 
 namespace {
+   /* the plugin reports every change it sees, so this only ages out values it may have missed */
+   constexpr auto kCacheMaxAge {10min};
    constexpr auto kEmptyWait {100ms};
    constexpr auto kLrInPort {58764};
+   constexpr auto kMaxBatch {256U};
+   constexpr auto kResync {"Xk2QvR7hLwz0dT"};
    constexpr auto kTerminate {"MBxegp3VXilFy0"};
+   constexpr auto kUnansweredRetry {30s};
 } // namespace
 
 LrIpcIn::LrIpcIn(ControlsModel& c_model, ProfileManager& profile_manager, const Profile& profile,
-    const MidiSender& midi_sender)
+    const MidiSender& midi_sender, LrIpcOut& lr_ipc_out)
     : midi_sender_ {midi_sender}, profile_ {profile}, controls_model_ {c_model},
-      profile_manager_ {profile_manager}
+      lr_ipc_out_ {lr_ipc_out}, profile_manager_ {profile_manager},
+      line_to_midi_ {rsj::Metrics().GetHistogram("latency.line_to_midi")}
 {
 }
 
+void LrIpcIn::Resync()
+{
+   try {
+      /* the cache belongs to the ProcessLine thread, so the work is queued there */
+      line_.emplace(kResync);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 void LrIpcIn::Start()
 {
    try {
@@ -109,6 +132,7 @@ void LrIpcIn::Connect()
           [this](const asio::error_code& error) {
              if (!error) {
                 rsj::Log("Socket connected in LR_IPC_In.");
+                forget_unanswered_ = true;
                 Read();
              }
              else {
@@ -128,69 +152,192 @@ void LrIpcIn::Connect()
    }
 }
 
-namespace {
-   std::pair<std::string_view, std::string_view> SplitLine(std::string_view msg)
-   {
-      rsj::Trim(msg);
-      const auto first_delimiter {msg.find_first_of(" \t\n")};
-      auto value_view {msg.substr(first_delimiter + 1)};
-      rsj::TrimL(value_view);
-      const auto command_view {msg.substr(0, first_delimiter)};
-      return {command_view, value_view};
-   }
-} // namespace
+std::pair<std::string_view, std::string_view> rsj::SplitLine(std::string_view msg)
+{
+   rsj::Trim(msg);
+   const auto first_delimiter {msg.find_first_of(" \t\n")};
+   auto value_view {msg.substr(first_delimiter + 1)};
+   rsj::TrimL(value_view);
+   const auto command_view {msg.substr(0, first_delimiter)};
+   return {command_view, value_view};
+}
 
 void LrIpcIn::ProcessLine()
 {
    try {
       do {
-         const auto line_copy {line_.pop()};
-         if (line_copy == kTerminate)
-            return;
-         auto [command_view, value_view] {SplitLine(line_copy)};
-         const auto command {std::string(command_view)};
-         if (command == "TerminateApplication") {
-            juce::JUCEApplication::getInstance()->systemRequestedQuit();
-            return;
+         /* drain whatever has queued up behind this line, so a refresh burst is converted in
+          * batches rather than one value at a time */
+         auto line_copy {line_.pop()};
+         do {
+            if (!ProcessOneLine(line_copy.line, line_copy.received_ms))
+               return;
+            if (batch_messages_.size() >= kMaxBatch)
+               SendBatch();
+            spare_lines_.push(std::move(line_copy.line));
+            auto next {line_.try_pop()};
+            if (!next)
+               break;
+            line_copy = std::move(*next);
+         } while (true);
+         SendBatch();
+      } while (true);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+bool LrIpcIn::ProcessOneLine(const std::string& line_copy, const double received_ms)
+{
+   try {
+      MIDI2LR_ALLOC_SCOPE("LrIpcIn line");
+      if (line_copy == kTerminate)
+         return false;
+      if (line_copy == kResync) {
+         ResyncFromCache();
+         return true;
+      }
+      auto [command_view, value_view] {rsj::SplitLine(line_copy)};
+      command_.assign(command_view);
+      const auto& command {command_};
+      if (command == "TerminateApplication") {
+         juce::JUCEApplication::getInstance()->systemRequestedQuit();
+         return false;
+      }
+      if (value_view.empty()) {
+         rsj::Log(fmt::format(
+             FMT_STRING("No value attached to message. Message from plugin was \"{}\"."),
+             rsj::ReplaceInvisibleChars(line_copy)));
+         return true;
+      }
+      if (command == "SwitchProfile" || command == "Log" || command == "SendKey")
+         SendBatch(); /* keep MIDI output in step with the plugin's ordering */
+      if (command == "SwitchProfile") {
+         profile_manager_.SwitchToProfile(std::string(value_view));
+      }
+      else if (command == "Log") {
+         rsj::Log(fmt::format(FMT_STRING("Plugin: {}."), value_view));
+      }
+      else if (command == "SendKey") {
+         const auto modifiers {std::stoi(std::string(value_view))};
+         /* trim twice on purpose: first modifiers digits, then one space (fixed delimiter) */
+         const auto first_not_digit {value_view.find_first_not_of("0123456789")};
+         if (first_not_digit != std::string_view::npos) {
+            value_view.remove_prefix(first_not_digit + 1);
+            if (!value_view.empty()) {
+               rsj::SendKeyDownUp(
+                   std::string(value_view), rsj::ActiveModifiers::FromMidi2LR(modifiers));
+               return true; /* skip logandalert error */
+            }
          }
-         if (value_view.empty()) {
-            rsj::Log(fmt::format(
-                FMT_STRING("No value attached to message. Message from plugin was \"{}\"."),
-                rsj::ReplaceInvisibleChars(line_copy)));
+         rsj::LogAndAlertError(fmt::format(
+             FMT_STRING("SendKey couldn't identify keystroke. Message from plugin was \"{}\"."),
+             rsj::ReplaceInvisibleChars(line_copy)));
+      }
+      else { /* queue associated messages for MIDI OUT devices */
+         value_text_.assign(value_view);
+         const auto original_value {std::stod(value_text_)};
+         rsj::Trace(rsj::TraceStage::kLrProcess, command, original_value);
+         value_cache_[command] = {original_value, std::chrono::steady_clock::now()};
+         const auto contents {profile_.GetContents()};
+         const auto [begin, end] {contents->command_string_map.equal_range(command)};
+         for (auto it {begin}; it != end; ++it) {
+            batch_messages_.push_back(it->second);
+            batch_values_.push_back(original_value);
+            batch_received_.push_back(received_ms);
          }
-         else if (command == "SwitchProfile") {
-            profile_manager_.SwitchToProfile(std::string(value_view));
+      }
+      return true;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+/* Values Lightroom already reported go straight to the controllers. Lightroom is only asked for
+ * the rest, or for everything when nothing has been cached yet. Commands it was asked for recently
+ * and didn't report aren't asked for again until kUnansweredRetry has passed */
+void LrIpcIn::ResyncFromCache()
+{
+   try {
+      SendBatch();
+      const auto contents {profile_.GetContents()};
+      const auto now {std::chrono::steady_clock::now()};
+      if (forget_unanswered_.exchange(false))
+         unanswered_.clear();
+      std::string missing {};
+      const std::string* last_missing {nullptr};
+      size_t hits {0};
+      for (const auto& [command, message] : contents->command_string_map) {
+         if (command == CommandSet::kUnassigned)
+            continue;
+         const auto found {value_cache_.find(command)};
+         if (found != value_cache_.end() && now - found->second.received < kCacheMaxAge) {
+            batch_messages_.push_back(message);
+            batch_values_.push_back(found->second.value);
+            batch_received_.push_back(0.0);
+            ++hits;
+            if (batch_messages_.size() >= kMaxBatch)
+               SendBatch();
          }
-         else if (command == "Log") {
-            rsj::Log(fmt::format(FMT_STRING("Plugin: {}."), value_view));
+         else if (const auto asked {unanswered_.find(command)}; found == value_cache_.end()
+                  && asked != unanswered_.end() && now - asked->second < kUnansweredRetry)
+            continue;
+         else if (!last_missing || *last_missing != command) { /* map holds commands in order */
+            missing.append(command).push_back(' ');
+            last_missing = &command;
          }
-         else if (command == "SendKey") {
-            const auto modifiers {std::stoi(std::string(value_view))};
-            /* trim twice on purpose: first modifiers digits, then one space (fixed delimiter) */
-            const auto first_not_digit {value_view.find_first_not_of("0123456789")};
-            if (first_not_digit != std::string_view::npos) {
-               value_view.remove_prefix(first_not_digit + 1);
-               if (!value_view.empty()) {
-                  rsj::SendKeyDownUp(
-                      std::string(value_view), rsj::ActiveModifiers::FromMidi2LR(modifiers));
-                  continue; /* skip logandalert error */
-               }
-            }
-            rsj::LogAndAlertError(fmt::format(
-                FMT_STRING("SendKey couldn't identify keystroke. Message from plugin was \"{}\"."),
-                rsj::ReplaceInvisibleChars(line_copy)));
+      }
+      SendBatch();
+      if (hits == 0) {
+         unanswered_.clear();
+         lr_ipc_out_.SendCommand("FullRefresh 1\n");
+      }
+      else if (!missing.empty()) {
+         /* any of these that get a value are found in the cache next time */
+         for (auto start {missing.begin()}; start != missing.end();) {
+            const auto end {std::find(start, missing.end(), ' ')};
+            unanswered_.insert_or_assign(std::string(start, end), now);
+            start = end + 1;
          }
-         else { /* send associated messages to MIDI OUT devices */
-            const auto original_value {std::stod(std::string(value_view))};
-            for (const auto& msg : profile_.GetMessagesForCommand(command)) {
-               /* following needs to run for all controls: sets saved value */
-               const auto value {controls_model_.PluginToController(msg, original_value)};
-               if (msg.msg_id_type != rsj::MessageType::kCc
-                   || controls_model_.GetCcMethod(msg) == rsj::CCmethod::kAbsolute)
-                  midi_sender_.Send(msg, value);
-            }
+         missing.back() = '\n';
+         lr_ipc_out_.SendCommand("RefreshParams " + missing);
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void LrIpcIn::SendBatch()
+{
+   try {
+      if (batch_messages_.empty())
+         return;
+      {
+         MIDI2LR_ALLOC_SCOPE("LrIpcIn line");
+         batch_results_.resize(batch_messages_.size());
+         /* following needs to run for all controls: sets saved value */
+         controls_model_.PluginToControllerBatch(batch_messages_, batch_values_, batch_results_);
+      }
+      for (size_t i {0}; i < batch_messages_.size(); ++i) {
+         const auto& msg {batch_messages_[i]};
+         if (controls_model_.IsTouched(msg))
+            continue; /* sent when the fader is let go, see LrIpcOut::SendHeldFeedback */
+         if (msg.msg_id_type != rsj::MessageType::kCc
+             || controls_model_.GetCcMethod(msg) == rsj::CCmethod::kAbsolute) {
+            midi_sender_.Send(msg, batch_results_[i], profile_.GetDeviceForMessage(msg));
+            if (batch_received_[i] > 0.0)
+               line_to_midi_.Record(rsj::MicrosecondsSince(batch_received_[i]));
          }
-      } while (true);
+      }
+      batch_messages_.clear();
+      batch_values_.clear();
+      batch_received_.clear();
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -210,11 +357,17 @@ void LrIpcIn::Read()
                       if (!bytes_transferred)
                          [[unlikely]] std::this_thread::sleep_for(kEmptyWait);
                       else {
-                         std::string command {buffers_begin(streambuf_.data()),
-                             buffers_begin(streambuf_.data()) + bytes_transferred};
+                         MIDI2LR_ALLOC_SCOPE("LrIpcIn read");
+                         /* resize and copy: assigning from buffer iterators may go through a
+                          * temporary string */
+                         auto command {spare_lines_.try_pop().value_or(std::string {})};
+                         command.resize(bytes_transferred);
+                         asio::buffer_copy(asio::buffer(command), streambuf_.data());
+                         rsj::TraceLine(rsj::TraceStage::kLrRead, command);
                          if (command == "TerminateApplication 1\n")
                             thread_should_exit_.store(true, std::memory_order_release);
-                         line_.push(std::move(command));
+                         line_.emplace(
+                             std::move(command), juce::Time::getMillisecondCounterHiRes());
                          streambuf_.consume(bytes_transferred);
                       }
                       Read();
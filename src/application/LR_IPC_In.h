@@ -16,32 +16,57 @@
  *
  */
 #include <atomic>
+#include <chrono>
 #include <future>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <asio.hpp>
 
 #include "Concurrency.h"
+#include "MidiUtilities.h"
 class ControlsModel;
+class LrIpcOut;
 class MidiSender;
 class Profile;
 class ProfileManager;
+namespace rsj {
+   class Histogram;
+   /* splits a line from the plugin into command and value, both trimmed */
+   [[nodiscard]] std::pair<std::string_view, std::string_view> SplitLine(std::string_view msg);
+}
 class LrIpcIn {
  public:
    LrIpcIn(ControlsModel& c_model, ProfileManager& profile_manager, const Profile& profile,
-       const MidiSender& midi_sender);
+       const MidiSender& midi_sender, LrIpcOut& lr_ipc_out);
    ~LrIpcIn() = default;
    LrIpcIn(const LrIpcIn& other) = delete;
    LrIpcIn(LrIpcIn&& other) = delete;
    LrIpcIn& operator=(const LrIpcIn& other) = delete;
    LrIpcIn& operator=(LrIpcIn&& other) = delete;
+   /* brings the controllers in line with the current profile, from cached values where it can */
+   void Resync();
    void Start();
    void Stop();
 
  private:
+   struct CachedValue {
+      double value {0.0};
+      std::chrono::steady_clock::time_point received {};
+   };
+   struct QueuedLine {
+      std::string line;
+      double received_ms {0.0}; /* juce::Time::getMillisecondCounterHiRes, 0 if not read */
+   };
    void Connect();
+   bool ProcessOneLine(const std::string& line_copy, double received_ms);
    void ProcessLine();
    void Read();
+   void ResyncFromCache();
+   void SendBatch();
 
    asio::io_context io_context_ {1};
    asio::ip::tcp::socket socket_ {io_context_};
@@ -49,9 +74,26 @@ class LrIpcIn {
    const MidiSender& midi_sender_;
    const Profile& profile_;
    ControlsModel& controls_model_;
+   LrIpcOut& lr_ipc_out_;
    ProfileManager& profile_manager_;
-   rsj::ConcurrentQueue<std::string> line_;
+   rsj::ConcurrentQueue<QueuedLine, rsj::RingDeque<QueuedLine>> line_;
+   /* lines already processed, handed back to Read so their buffers are reused */
+   rsj::ConcurrentQueue<std::string, rsj::RingDeque<std::string>> spare_lines_;
    std::atomic<bool> thread_should_exit_ {false};
+   std::atomic<bool> forget_unanswered_ {false}; /* set on connect, read by ProcessLine thread */
+   /* ProcessLine thread only */
+   std::string command_ {}; /* reused so that lines don't allocate once warmed up */
+   std::string value_text_ {};
+   std::vector<rsj::MidiMessageId> batch_messages_ {};
+   std::vector<double> batch_values_ {};
+   std::vector<double> batch_received_ {}; /* 0 for values from the cache */
+   std::vector<int> batch_results_ {};
+   std::unordered_map<std::string, CachedValue> value_cache_ {}; /* last value of each command */
+   /* asked for by RefreshParams but not reported yet, with when they were asked. Buttons and
+    * actions never have a value, but Lightroom also stays silent outside Develop, so these are
+    * forgotten on reconnect, on FullRefresh and after kUnansweredRetry */
+   std::unordered_map<std::string, std::chrono::steady_clock::time_point> unanswered_ {};
+   rsj::Histogram& line_to_midi_;
    std::future<void> io_thread_;
    std::future<void> process_line_future_;
 };
@@ -18,12 +18,16 @@
 #include <algorithm>
 #include <chrono>
 #include <exception>
+#include <iterator>
 #include <utility>
 
 #include <fmt/format.h>
 
+#include "AllocationAccounting.h"
 #include "CommandSet.h"
 #include "ControlsModel.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
 #include "MIDIReceiver.h"
 #include "MIDISender.h"
 #include "MidiUtilities.h"
@@ -36,8 +40,12 @@ using namespace std::literals::chrono_literals;
 
 namespace {
    constexpr auto kDelay {8ms}; /* in between recurrent actions */
+   constexpr auto kHeldValueMaxAge {5s};
+   constexpr size_t kMaxHeldControls {512};
    constexpr auto kLrOutPort {58763};
    constexpr auto kMinRecenterTime {250ms}; /* minimum period before recentering */
+   constexpr auto kPickupNoticeInterval {100ms};
+   constexpr auto kPickupRefreshInterval {1s};
    constexpr auto kRecenterTimer {std::max(kMinRecenterTime, kDelay + kDelay / 2)};
    constexpr auto kTerminate {"!!!@#$%^"};
 } // namespace
@@ -45,7 +53,11 @@ namespace {
 LrIpcOut::LrIpcOut(const CommandSet& command_set, ControlsModel& c_model, const Profile& profile,
     const MidiSender& midi_sender, MidiReceiver& midi_receiver)
     : midi_sender_ {midi_sender}, profile_ {profile}, repeat_cmd_ {command_set.GetRepeats()},
-      wrap_ {command_set.GetWraps()}, controls_model_ {c_model}
+      wrap_ {command_set.GetWraps()}, controls_model_ {c_model},
+      held_coalesced_count_ {rsj::Metrics().GetCounter("held.coalesced")},
+      held_dropped_count_ {rsj::Metrics().GetCounter("held.dropped")},
+      held_expired_count_ {rsj::Metrics().GetCounter("held.expired")},
+      midi_to_socket_ {rsj::Metrics().GetHistogram("latency.midi_to_socket")}
 {
    midi_receiver.AddCallback(this, &LrIpcOut::MidiCmdCallback);
 }
@@ -112,6 +124,11 @@ void LrIpcOut::Stop()
    /* clear output queue before port closed */
    if (const auto m {command_.clear_count_emplace(kTerminate)})
       rsj::Log(fmt::format(FMT_STRING("{} left in queue in LrIpcOut destructor."), m));
+   if (const auto suppressed {controls_model_.DeadbandSuppressed()})
+      rsj::Log(fmt::format(FMT_STRING("{} jittering control values dropped by deadband."),
+          suppressed));
+   if (const auto echoes {controls_model_.EchoSuppressed()})
+      rsj::Log(fmt::format(FMT_STRING("{} echoes from motorized controls dropped."), echoes));
    callbacks_.clear(); /* no more connect/disconnect notifications */
    asio::post([this] {
       if (socket_.is_open()) {
@@ -157,10 +174,23 @@ void LrIpcOut::Connect()
    }
 }
 
+void LrIpcOut::ConnectionLost()
+{
+   try {
+      connected_.store(false, std::memory_order_release);
+      rsj::Log("Socket disconnected in LR_IPC_Out.");
+      for (const auto& cb : callbacks_) cb(false, sending_stopped_);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 void LrIpcOut::ConnectionMade()
 {
-   connected_.store(true, std::memory_order_release);
    try {
+      ReleaseHeld();
       rsj::Log("Socket connected in LR_IPC_Out.");
       for (const auto& cb : callbacks_) cb(true, sending_stopped_);
    }
@@ -170,12 +200,87 @@ void LrIpcOut::ConnectionMade()
    }
 }
 
+/* Until Lightroom connects, control messages are held in order, up to a limit, while controller
+ * input keeps only the latest value of each command. Replaying every move made in the meantime
+ * would just drag Lightroom through stale values */
+void LrIpcOut::HoldCommand(std::string&& command, const bool is_value)
+{
+   try {
+      auto lock {std::scoped_lock(held_mutex_)};
+      if (connected_.load(std::memory_order_acquire)) { /* connected since the caller checked */
+         command_.emplace(std::move(command));
+         return;
+      }
+      if (is_value) {
+         auto name {command.substr(0, command.find(' '))};
+         if (!held_values_
+                  .insert_or_assign(std::move(name), HeldValue {std::move(command), Clock::now()})
+                  .second)
+            held_coalesced_count_.Add();
+         return;
+      }
+      if (held_controls_.size() >= kMaxHeldControls) {
+         held_controls_.pop_front();
+         ++held_dropped_;
+         held_dropped_count_.Add();
+      }
+      held_controls_.push_back(std::move(command));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+/* connected_ is set under held_mutex_ after the held commands are queued, so nothing sent
+ * meanwhile can get ahead of them */
+void LrIpcOut::ReleaseHeld()
+{
+   try {
+      auto lock {std::scoped_lock(held_mutex_)};
+      for (auto& command : held_controls_) command_.emplace(std::move(command));
+      const auto cutoff {Clock::now() - kHeldValueMaxAge};
+      size_t expired {0};
+      for (auto& [name, value] : held_values_) {
+         if (value.held >= cutoff)
+            command_.emplace(std::move(value.command));
+         else
+            ++expired;
+      }
+      held_expired_count_.Add(expired);
+      if (held_dropped_ || expired)
+         rsj::Log(fmt::format(
+             FMT_STRING("LR_IPC_Out dropped {} control messages and {} stale values held before "
+                        "connecting."),
+             held_dropped_, expired));
+      held_controls_.clear();
+      held_values_.clear();
+      held_dropped_ = 0;
+      connected_.store(true, std::memory_order_release);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 void LrIpcOut::MidiCmdCallback(const rsj::MidiMessage& mm)
 {
    try {
+      if (const auto released {controls_model_.UpdateTouch(mm)})
+         SendHeldFeedback(released, mm.device);
+      if (controls_model_.InDeadband(mm))
+         return; /* jitter from a resting control */
+      if (const auto window {echo_window_ms_.load(std::memory_order_acquire)};
+          window > 0 && controls_model_.IsEcho(mm, window))
+         return; /* a motorized control reporting the value it was sent */
+      rsj::Trace(rsj::TraceStage::kModel, mm);
       const rsj::MidiMessageId message {mm};
-      if (profile_.MessageExistsInMap(message)) {
-         const auto command_to_send {profile_.GetCommandForMessage(message)};
+      /* holding the contents keeps command_to_send valid without copying it */
+      const auto contents {profile_.GetContents()};
+      if (const auto found {contents->message_map.find(message)};
+          found != contents->message_map.end()) {
+         const auto& command_to_send {found->second};
          if (command_to_send != "PrevPro" && command_to_send != "NextPro"
              && command_to_send != CommandSet::kUnassigned) { /* handled elsewhere */
             if (const auto a {repeat_cmd_.find(command_to_send)}; a != repeat_cmd_.end())
@@ -187,21 +292,30 @@ void LrIpcOut::MidiCmdCallback(const rsj::MidiMessage& mm)
                      if ((mm.message_type_byte == rsj::MessageType::kCc
                              && controls_model_.GetCcMethod(message) == rsj::CCmethod::kAbsolute)
                          || mm.message_type_byte == rsj::MessageType::kPw)
-                        SetRecenter(message);
+                        SetRecenter(message, mm.device);
                      const auto change {controls_model_.MeasureChange(mm)};
-                     const auto [cw, ccw] {a->second};
+                     const auto& [cw, ccw] {a->second};
                      if (change > 0)
-                        SendCommand(cw); /* turned clockwise */
+                        SendValue(QueuedCommand(cw, mm.timestamp * 1000.0)); /* clockwise */
                      else if (change < 0)
-                        SendCommand(ccw); /* turned counterclockwise */
+                        SendValue(QueuedCommand(ccw, mm.timestamp * 1000.0)); /* ccw */
                      /* do nothing if change == 0 */
                   }
                }
             else { /* not repeated command */
+               if (pickup_enabled_.load(std::memory_order_acquire)
+                   && !controls_model_.PickupAllows(mm)) {
+                  PickupFailed(command_to_send, mm);
+                  return;
+               }
                const auto wrap {
                    std::find(wrap_.begin(), wrap_.end(), command_to_send) != wrap_.end()};
                const auto computed_value {controls_model_.ControllerToPlugin(mm, wrap)};
-               SendCommand(fmt::format(FMT_STRING("{} {}\n"), command_to_send, computed_value));
+               QueuedCommand value {};
+               value.origin_ms = mm.timestamp * 1000.0;
+               fmt::format_to(std::back_inserter(value.command), FMT_STRING("{} {}\n"),
+                   command_to_send, computed_value);
+               SendValue(std::move(value));
             }
          }
       }
@@ -212,21 +326,72 @@ void LrIpcOut::MidiCmdCallback(const rsj::MidiMessage& mm)
    }
 }
 
+/* Input was held back because the control hasn't reached Lightroom's value. As when the plugin
+ * applied pickup, it shows the control's value beside Lightroom's, and the controls are refreshed
+ * once a second so they can be matched to Lightroom */
+void LrIpcOut::PickupFailed(const std::string& command, const rsj::MidiMessage& mm)
+{
+   try {
+      if (!connected_.load(std::memory_order_acquire))
+         return;
+      const auto now {Clock::now()};
+      if (next_pickup_notice_ <= now) {
+         next_pickup_notice_ = now + kPickupNoticeInterval;
+         const auto wrap {std::find(wrap_.begin(), wrap_.end(), command) != wrap_.end()};
+         SendCommand(fmt::format(FMT_STRING("PickupFailed {} {}\n"), command,
+             controls_model_.ControllerToPlugin(mm, wrap)));
+      }
+      if (next_pickup_refresh_ <= now) {
+         next_pickup_refresh_ = now + kPickupRefreshInterval;
+         SendCommand("FullRefresh 1\n");
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+/* LrIpcIn holds feedback to touched faders. Once let go, they move to Lightroom's value */
+void LrIpcOut::SendHeldFeedback(const std::uint16_t channels, const rsj::DeviceId device)
+{
+   try {
+      for (auto channel {0}; channel < 16; ++channel)
+         if (channels & 1U << channel)
+            if (const auto value {controls_model_.TakePwFeedback(channel)}; value >= 0)
+               midi_sender_.Send({channel + 1, 0, rsj::MessageType::kPw}, value, device);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 void LrIpcOut::SendOut()
 {
    try {
-      auto command_copy {std::make_shared<std::string>(command_.pop())};
-      if (*command_copy == kTerminate)
+      MIDI2LR_ALLOC_SCOPE("LrIpcOut write");
+      sending_ = command_.pop();
+      if (sending_.View() == kTerminate)
          [[unlikely]] return;
-      if (command_copy->back() != '\n') /* should be terminated with \n */
-         [[unlikely]] command_copy->push_back('\n');
-      // ReSharper disable once CppLambdaCaptureNeverUsed
-      asio::async_write(socket_, asio::buffer(*command_copy),
-          [this, command_copy](const asio::error_code& error, std::size_t) {
+      if (const auto view {sending_.View()};
+          view.empty() || view.back() != '\n') /* should be terminated with \n */
+         [[unlikely]] sending_.command.push_back('\n');
+      asio::async_write(socket_, asio::buffer(sending_.command.data(), sending_.command.size()),
+          [this](const asio::error_code& error, std::size_t) {
              if (!error)
-                [[likely]] SendOut();
+                [[likely]]
+                {
+                   rsj::TraceLine(rsj::TraceStage::kSocketWrite, sending_.View());
+                   if (sending_.origin_ms > 0.0)
+                      midi_to_socket_.Record(rsj::MicrosecondsSince(sending_.origin_ms));
+                   SendOut();
+                }
              else {
                 rsj::Log(fmt::format(FMT_STRING("LR_IPC_Out Write: {}."), error.message()));
+                /* later commands are held, bounded, rather than queued without limit */
+                if (!thread_should_exit_.load(std::memory_order_acquire))
+                   ConnectionLost();
              }
           });
    }
@@ -236,15 +401,15 @@ void LrIpcOut::SendOut()
    }
 }
 
-void LrIpcOut::SetRecenter(rsj::MidiMessageId mm)
+void LrIpcOut::SetRecenter(rsj::MidiMessageId mm, const rsj::DeviceId device)
 {
    /* by capturing mm by copy, don't have to worry about later calls changing it--those will just
     * cancel and reschedule new one */
    try {
       asio::dispatch([this] { recenter_timer_.expires_after(kRecenterTimer); });
-      recenter_timer_.async_wait([this, mm](const asio::error_code& error) {
+      recenter_timer_.async_wait([this, mm, device](const asio::error_code& error) {
          if (!error && !thread_should_exit_.load(std::memory_order_acquire))
-            midi_sender_.Send(mm, controls_model_.SetToCenter(mm));
+            midi_sender_.Send(mm, controls_model_.SetToCenter(mm), device);
       });
    }
    catch (const std::exception& e) {
@@ -16,14 +16,20 @@
  *
  */
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <asio.hpp>
+#include <fmt/format.h>
 
 #include "Concurrency.h"
 #include "MidiUtilities.h"
@@ -32,6 +38,10 @@ class ControlsModel;
 class MidiReceiver;
 class MidiSender;
 class Profile;
+namespace rsj {
+   class Counter;
+   class Histogram;
+} // namespace rsj
 #ifndef _MSC_VER
 #define _In_
 #endif
@@ -55,13 +65,24 @@ class LrIpcOut {
    }
    void SendCommand(std::string&& command)
    {
-      if (!sending_stopped_)
-         command_.push(std::move(command));
+      if (!sending_stopped_) {
+         if (connected_.load(std::memory_order_acquire))
+            command_.emplace(std::move(command));
+         else
+            HoldCommand(std::move(command), false);
+      }
    }
-   void SendCommand(const std::string& command)
+   void SendCommand(const std::string& command) { SendCommand(std::string(command)); }
+   /* input matching what was sent to a control within this many ms is its echo. 0 disables */
+   void SetEchoWindow(int window_ms) noexcept
    {
-      if (!sending_stopped_)
-         command_.push(command);
+      echo_window_ms_.store(window_ms, std::memory_order_release);
+   }
+   /* pickup is applied here rather than in the plugin, so it only needs the values Lightroom
+    * already reports through LrIpcIn */
+   void SetPickupEnabled(bool enabled) noexcept
+   {
+      pickup_enabled_.store(enabled, std::memory_order_release);
    }
    void SendingRestart();
    void SendingStop();
@@ -69,11 +90,46 @@ class LrIpcOut {
    void Stop();
 
  private:
+   struct HeldValue {
+      std::string command;
+      std::chrono::steady_clock::time_point held;
+   };
+   static constexpr size_t kInlineCommand {64};
+   struct QueuedCommand {
+      QueuedCommand() = default;
+      explicit QueuedCommand(std::string_view text, double origin = 0.0) : origin_ms {origin}
+      {
+         command.append(text.data(), text.data() + text.size());
+      }
+      [[nodiscard]] std::string_view View() const noexcept
+      {
+         return {command.data(), command.size()};
+      }
+      /* long enough for any parameter value line, so queuing controller input doesn't allocate */
+      fmt::basic_memory_buffer<char, kInlineCommand> command {};
+      double origin_ms {0.0}; /* arrival of the MIDI input behind it, 0 if none */
+   };
    void Connect();
+   void ConnectionLost();
    void ConnectionMade();
+   void HoldCommand(std::string&& command, bool is_value);
    void MidiCmdCallback(const rsj::MidiMessage&);
+   void PickupFailed(const std::string& command, const rsj::MidiMessage& mm);
+   void ReleaseHeld();
+   void SendHeldFeedback(std::uint16_t channels, rsj::DeviceId device);
    void SendOut();
-   void SetRecenter(rsj::MidiMessageId mm);
+   /* controller input. Unlike SendCommand, only the latest value per command is held while
+    * Lightroom isn't connected */
+   void SendValue(QueuedCommand&& value)
+   {
+      if (!sending_stopped_) {
+         if (connected_.load(std::memory_order_acquire))
+            command_.push(std::move(value));
+         else
+            HoldCommand(std::string(value.View()), true);
+      }
+   }
+   void SetRecenter(rsj::MidiMessageId mm, rsj::DeviceId device);
 
    asio::io_context io_context_ {};
    asio::ip::tcp::socket socket_ {io_context_};
@@ -84,12 +140,27 @@ class LrIpcOut {
    const std::unordered_map<std::string, std::pair<std::string, std::string>>& repeat_cmd_;
    const std::vector<std::string>& wrap_;
    ControlsModel& controls_model_;
-   rsj::ConcurrentQueue<std::string> command_;
+   rsj::ConcurrentQueue<QueuedCommand, rsj::RingDeque<QueuedCommand>> command_;
+   QueuedCommand sending_ {}; /* SendOut has one write in flight at a time */
    std::atomic<bool> connected_ {false};
+   std::atomic<int> echo_window_ms_ {0};
+   std::atomic<bool> pickup_enabled_ {true};
+   /* MidiCmdCallback thread only */
+   std::chrono::steady_clock::time_point next_pickup_notice_ {};
+   std::chrono::steady_clock::time_point next_pickup_refresh_ {};
    std::atomic<bool> thread_should_exit_ {false};
    std::future<void> io_thread0_;
    std::future<void> io_thread1_; /* need second thread for recenter timer */
    std::vector<std::function<void(bool, bool)>> callbacks_ {};
+   /* commands sent while not connected, released in ReleaseHeld */
+   std::mutex held_mutex_;
+   std::deque<std::string> held_controls_ {};
+   std::unordered_map<std::string, HeldValue> held_values_ {}; /* keyed by command name */
+   size_t held_dropped_ {0};
+   rsj::Counter& held_coalesced_count_;
+   rsj::Counter& held_dropped_count_;
+   rsj::Counter& held_expired_count_;
+   rsj::Histogram& midi_to_socket_;
 };
 
 #endif
@@ -17,17 +17,30 @@
 
 #include <chrono>
 #include <exception>
+#include <thread>
 #include <utility>
 
 #include <fmt/format.h>
 
+#include "AllocationAccounting.h"
+#include "ControlsModel.h"
 #include "Devices.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
 #include "Misc.h"
+#include "SessionRecording.h"
 
 namespace {
    constexpr rsj::MidiMessage kTerminate {rsj::MessageType::kCc, 129, 0, 0}; /* impossible */
 }
 
+MidiReceiver::MidiReceiver(Devices& devices, const ControlsModel& controls_model)
+    : devices_(devices), controls_model_(controls_model)
+{
+}
+
+MidiReceiver::~MidiReceiver() = default; /* SessionWriter complete here */
+
 void MidiReceiver::Start()
 {
    try {
@@ -46,6 +59,10 @@ void MidiReceiver::Start()
 
 void MidiReceiver::Stop()
 {
+   replay_should_stop_.store(true, std::memory_order_release);
+   if (replay_future_.valid())
+      replay_future_.wait();
+   StopRecording();
    for (const auto& dev : input_devices_) {
       dev->stop();
       rsj::Log(fmt::format(FMT_STRING("Stopped input device {}."), dev->getName().toStdString()));
@@ -62,14 +79,24 @@ void MidiReceiver::handleIncomingMidiMessage(
     * near-real-time, so must return quickly. will place message in multithreaded queue and let
     * separate process handle the messages */
    try {
-      const rsj::MidiMessage mess {message};
+      MIDI2LR_ALLOC_SCOPE("MidiReceiver input");
+      const auto dev_id {device_ids_.find(device)};
+      const rsj::MidiMessage mess {
+          message, dev_id != device_ids_.end() ? dev_id->second : rsj::kAnyDevice};
+      rsj::Trace(rsj::TraceStage::kMidiIn, mess);
+      if (const auto counter {device_counters_.find(device)}; counter != device_counters_.end())
+         counter->second->Add();
       switch (mess.message_type_byte) {
       case rsj::MessageType::kCc: {
-         const auto result {filters_[device](mess)};
+         const auto filter {filters_.find(device)};
+         if (filter == filters_.end())
+            break; /* not one of ours */
+         const auto result {filter->second(mess)};
          if (result.is_nrpn) {
             /* send when complete */
             if (result.is_ready)
-               messages_.emplace(rsj::MessageType::kCc, mess.channel, result.control, result.value);
+               messages_.emplace(rsj::MessageType::kCc, mess.channel, result.control, result.value,
+                   mess.device, mess.timestamp);
             /* finished with nrpn piece */
             break;
          }
@@ -80,9 +107,15 @@ void MidiReceiver::handleIncomingMidiMessage(
       case rsj::MessageType::kPw:
          messages_.push(mess);
          break;
+      case rsj::MessageType::kNoteOff:
+         /* some touch faders report release as note off. Pass it on as the equivalent note on
+          * with velocity 0, which is what the rest of the app treats as a release */
+         if (controls_model_.IsTouchNote(mess.channel, mess.control_number))
+            messages_.emplace(rsj::MessageType::kNoteOn, mess.channel, mess.control_number, 0,
+                mess.device, mess.timestamp);
+         break;
       case rsj::MessageType::kChanPressure:
       case rsj::MessageType::kKeyPressure:
-      case rsj::MessageType::kNoteOff:
       case rsj::MessageType::kPgmChange:
       case rsj::MessageType::kSystem:
           /* no action if other type of MIDI message */;
@@ -103,6 +136,9 @@ void MidiReceiver::RescanDevices()
              fmt::format(FMT_STRING("Stopped input device {}."), dev->getName().toStdString()));
       }
       input_devices_.clear();
+      filters_.clear();
+      device_ids_.clear();
+      device_counters_.clear();
       rsj::Log("Cleared input devices.");
    }
    catch (const std::exception& e) {
@@ -115,14 +151,18 @@ void MidiReceiver::RescanDevices()
 void MidiReceiver::TryToOpen()
 {
    try {
+      /* the callbacks read the per-device maps unlocked, so they are filled for every device
+       * before any device starts */
+      const auto first_new {input_devices_.size()};
       const auto available_devices {juce::MidiInput::getAvailableDevices()};
       for (const auto& device : available_devices) {
          auto open_device {juce::MidiInput::openDevice(device.identifier, this)};
          if (open_device) {
             if (devices_.EnabledOrNew(open_device->getDeviceInfo(), "input")) {
-               open_device->start();
-               rsj::Log(fmt::format(
-                   FMT_STRING("Opened input device {}."), open_device->getName().toStdString()));
+               const auto name {open_device->getName().toStdString()};
+               filters_.try_emplace(open_device.get());
+               device_ids_[open_device.get()] = rsj::DeviceIdForName(name);
+               device_counters_[open_device.get()] = &rsj::Metrics().GetCounter("midi_in." + name);
                input_devices_.emplace_back(std::move(open_device));
             }
             else
@@ -130,6 +170,11 @@ void MidiReceiver::TryToOpen()
                    FMT_STRING("Ignored input device {}."), open_device->getName().toStdString()));
          }
       }
+      for (auto i {first_new}; i < input_devices_.size(); ++i) {
+         input_devices_[i]->start();
+         rsj::Log(fmt::format(
+             FMT_STRING("Opened input device {}."), input_devices_[i]->getName().toStdString()));
+      }
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -169,6 +214,13 @@ void MidiReceiver::DispatchMessages()
          const auto message_copy {messages_.pop()};
          if (message_copy == kTerminate)
             return;
+         MIDI2LR_ALLOC_SCOPE("MidiReceiver dispatch");
+         rsj::Trace(rsj::TraceStage::kDispatch, message_copy);
+         if (recording_.load(std::memory_order_acquire)) {
+            auto lock {std::scoped_lock(recording_mutex_)};
+            if (session_writer_)
+               session_writer_->Write(message_copy);
+         }
          for (const auto& cb : callbacks_)
 #pragma warning(suppress : 26489)
             /* false warning, checked for existence before adding to callbacks_ */
@@ -179,4 +231,106 @@ void MidiReceiver::DispatchMessages()
       MIDI2LR_E_RESPONSE;
       throw;
    }
-}
\ No newline at end of file
+}
+bool MidiReceiver::StartRecording(const juce::File& file)
+{
+   try {
+      auto writer {std::make_unique<SessionWriter>(file)};
+      if (!writer->Ok())
+         return false;
+      auto lock {std::scoped_lock(recording_mutex_)};
+      session_writer_ = std::move(writer);
+      recording_.store(true, std::memory_order_release);
+      rsj::Log(fmt::format(
+          FMT_STRING("Recording MIDI session to {}."), file.getFullPathName().toStdString()));
+      return true;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void MidiReceiver::StopRecording()
+{
+   try {
+      auto lock {std::scoped_lock(recording_mutex_)};
+      recording_.store(false, std::memory_order_release);
+      if (session_writer_) {
+         rsj::Log(fmt::format(FMT_STRING("Recorded {} MIDI messages."), session_writer_->Count()));
+         session_writer_.reset(); /* flushes */
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+bool MidiReceiver::Replay(
+    const juce::File& file, const double speed, std::function<void()> on_done)
+{
+   try {
+      if (!file.existsAsFile()) {
+         rsj::Log(fmt::format(
+             FMT_STRING("Replay file {} not found."), file.getFullPathName().toStdString()));
+         return false;
+      }
+      if (replay_future_.valid()
+          && replay_future_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+         rsj::Log("Replay already running.");
+         return false;
+      }
+      replay_should_stop_.store(false, std::memory_order_release);
+      replay_future_ =
+          std::async(std::launch::async, [this, file, speed, done = std::move(on_done)] {
+             rsj::LabelThread(L"MidiReceiver replay thread");
+             MIDI2LR_FAST_FLOATS;
+             ReplayMessages(file, speed);
+             if (done)
+                done();
+          });
+      return true;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void MidiReceiver::ReplayMessages(const juce::File& file, const double speed)
+{
+   try {
+      SessionReader reader {file};
+      if (!reader.Ok())
+         return;
+      auto& replayed {rsj::Metrics().GetCounter("midi_in.replay")};
+      const auto start {std::chrono::steady_clock::now()};
+      auto due {start};
+      size_t count {0};
+      while (!replay_should_stop_.load(std::memory_order_acquire)) {
+         auto entry {reader.Next()};
+         if (!entry)
+            break;
+         if (speed > 0.0) {
+            due += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(entry->delay / speed));
+            std::this_thread::sleep_until(due);
+         }
+         /* stamped now, so latency is measured from injection */
+         entry->message.timestamp = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+         MIDI2LR_ALLOC_SCOPE("MidiReceiver input");
+         rsj::Trace(rsj::TraceStage::kMidiIn, entry->message);
+         replayed.Add();
+         messages_.push(entry->message);
+         ++count;
+      }
+      rsj::Log(fmt::format(FMT_STRING("Replayed {} MIDI messages from {} in {:.3f} s."), count,
+          file.getFullPathName().toStdString(),
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
@@ -15,10 +15,12 @@
  * see <http://www.gnu.org/licenses/>.
  *
  */
+#include <atomic>
 #include <functional>
 #include <future>
 #include <map> /* map faster than unordered_map for very few members */
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <juce_audio_devices/juce_audio_devices.h>
@@ -26,7 +28,12 @@
 #include "Concurrency.h"
 #include "MidiUtilities.h"
 
+class ControlsModel;
 class Devices;
+class SessionWriter;
+namespace rsj {
+   class Counter;
+}
 
 #ifndef _MSC_VER
 #define _In_
@@ -34,8 +41,8 @@ class Devices;
 
 class MidiReceiver final : juce::MidiInputCallback {
  public:
-   explicit MidiReceiver(Devices& devices) : devices_(devices) {}
-   ~MidiReceiver() = default; // NOLINT(modernize-use-override)
+   MidiReceiver(Devices& devices, const ControlsModel& controls_model);
+   ~MidiReceiver(); // NOLINT(modernize-use-override)
    MidiReceiver(const MidiReceiver& other) = delete;
    MidiReceiver(MidiReceiver&& other) = delete;
    MidiReceiver& operator=(const MidiReceiver& other) = delete;
@@ -43,6 +50,16 @@ class MidiReceiver final : juce::MidiInputCallback {
    void RescanDevices();
    void Start();
    void Stop();
+   /* records dispatched messages, see SessionRecording.h */
+   [[nodiscard]] bool IsRecording() const noexcept
+   {
+      return recording_.load(std::memory_order_acquire);
+   }
+   bool StartRecording(const juce::File& file);
+   void StopRecording();
+   /* feeds a recording in as though it came from the devices. speed 1 keeps the recorded
+    * timing, 0 sends as fast as the queue takes it. on_done runs on the replay thread */
+   bool Replay(const juce::File& file, double speed, std::function<void()> on_done = {});
 
    template<class T>
    void AddCallback(_In_ T* const object, _In_ void (T::*const mf)(const rsj::MidiMessage&))
@@ -57,14 +74,25 @@ class MidiReceiver final : juce::MidiInputCallback {
    void DispatchMessages();
    void handleIncomingMidiMessage(juce::MidiInput*, const juce::MidiMessage&) override;
    void InitDevices();
+   void ReplayMessages(const juce::File& file, double speed);
    void TryToOpen(); /* inner code for InitDevices */
 
    Devices& devices_;
-   rsj::ConcurrentQueue<rsj::MidiMessage> messages_;
+   const ControlsModel& controls_model_;
+   rsj::ConcurrentQueue<rsj::MidiMessage, rsj::RingDeque<rsj::MidiMessage>> messages_;
    std::future<void> dispatch_messages_future_;
+   /* per-device state, read on the MIDI callback threads. Only changed while no device is
+    * started */
    std::map<juce::MidiInput*, NrpnFilter> filters_ {};
+   std::map<juce::MidiInput*, rsj::DeviceId> device_ids_ {};
+   std::map<juce::MidiInput*, rsj::Counter*> device_counters_ {}; /* messages per device */
    std::vector<std::function<void(const rsj::MidiMessage&)>> callbacks_;
    std::vector<std::unique_ptr<juce::MidiInput>> input_devices_;
+   std::atomic<bool> recording_ {false};
+   std::mutex recording_mutex_;
+   std::unique_ptr<SessionWriter> session_writer_; /* guarded by recording_mutex_ */
+   std::atomic<bool> replay_should_stop_ {false};
+   std::future<void> replay_future_;
 };
 
 #endif
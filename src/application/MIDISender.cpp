@@ -25,7 +25,9 @@
 #include <juce_audio_devices/juce_audio_devices.h>
 #include <juce_core/juce_core.h>
 
+#include "AllocationAccounting.h"
 #include "Devices.h"
+#include "FlightRecorder.h"
 #include "MidiUtilities.h"
 #include "Misc.h"
 
@@ -40,24 +42,42 @@ void MidiSender::Start()
    }
 }
 
-void MidiSender::Send(rsj::MidiMessageId id, int value) const
+template<class F> void MidiSender::ForEachTarget(const rsj::DeviceId device, F&& send) const
+{
+   if (device != rsj::kAnyDevice) {
+      auto found {false};
+      for (const auto& [id, dev] : output_devices_) {
+         if (id == device) {
+            send(*dev);
+            found = true;
+         }
+      }
+      if (found)
+         return;
+   }
+   for (const auto& dev : output_devices_) send(*dev.second);
+}
+
+void MidiSender::Send(rsj::MidiMessageId id, int value, const rsj::DeviceId device) const
 {
    try {
+      MIDI2LR_ALLOC_SCOPE("MidiSender send");
+      rsj::Trace(rsj::TraceStage::kMidiOut, id, device, value);
       if (id.msg_id_type == rsj::MessageType::kPw) {
          const auto msg {juce::MidiMessage::pitchWheel(id.channel, value)};
-         for (const auto& dev : output_devices_) dev->sendMessageNow(msg);
+         ForEachTarget(device, [&msg](juce::MidiOutput& dev) { dev.sendMessageNow(msg); });
       }
       else if (id.msg_id_type == rsj::MessageType::kNoteOn) {
          const auto msg {juce::MidiMessage::noteOn(
              id.channel, id.control_number, gsl::narrow_cast<juce::uint8>(value))};
-         for (const auto& dev : output_devices_) dev->sendMessageNow(msg);
+         ForEachTarget(device, [&msg](juce::MidiOutput& dev) { dev.sendMessageNow(msg); });
       }
       else if (id.msg_id_type == rsj::MessageType::kCc) {
          if (id.control_number < 128) {
             /* regular message */
             const auto msg {
                 juce::MidiMessage::controllerEvent(id.channel, id.control_number, value)};
-            for (const auto& dev : output_devices_) dev->sendMessageNow(msg);
+            ForEachTarget(device, [&msg](juce::MidiOutput& dev) { dev.sendMessageNow(msg); });
          }
          else {
             /* NRPN */
@@ -69,12 +89,12 @@ void MidiSender::Send(rsj::MidiMessageId id, int value) const
                 juce::MidiMessage::controllerEvent(id.channel, 6, value >> 7 & 0x7F)};
             const auto msg_val_lsb {
                 juce::MidiMessage::controllerEvent(id.channel, 38, value & 0x7f)};
-            for (const auto& dev : output_devices_) {
-               dev->sendMessageNow(msg_parm_msb);
-               dev->sendMessageNow(msg_parm_lsb);
-               dev->sendMessageNow(msg_val_msb);
-               dev->sendMessageNow(msg_val_lsb);
-            }
+            ForEachTarget(device, [&](juce::MidiOutput& dev) {
+               dev.sendMessageNow(msg_parm_msb);
+               dev.sendMessageNow(msg_parm_lsb);
+               dev.sendMessageNow(msg_val_msb);
+               dev.sendMessageNow(msg_val_lsb);
+            });
          }
       }
       else {
@@ -116,7 +136,8 @@ void MidiSender::InitDevices()
                if (devname != "Microsoft GS Wavetable Synth"
                    && devices_.EnabledOrNew(open_device->getDeviceInfo(), "output")) {
                   rsj::Log(fmt::format(FMT_STRING("Opened output device {}."), devname));
-                  output_devices_.emplace_back(std::move(open_device));
+                  output_devices_.emplace_back(
+                      rsj::DeviceIdForName(devname), std::move(open_device));
                }
                else
                   rsj::Log(fmt::format(FMT_STRING("Ignored output device {}."), devname));
@@ -124,7 +145,8 @@ void MidiSender::InitDevices()
             else {
                if (devices_.EnabledOrNew(open_device->getDeviceInfo(), "output")) {
                   rsj::Log(fmt::format(FMT_STRING("Opened output device {}."), devname));
-                  output_devices_.emplace_back(std::move(open_device));
+                  output_devices_.emplace_back(
+                      rsj::DeviceIdForName(devname), std::move(open_device));
                }
                else
                   rsj::Log(fmt::format(FMT_STRING("Ignored output device {}."), devname));
@@ -16,18 +16,17 @@
  *
  */
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include "MidiUtilities.h"
+
 class Devices;
 
 namespace juce {
    class MidiOutput;
 }
 
-namespace rsj {
-   struct MidiMessageId;
-}
-
 //-V813_MINSIZE=13 /* warn if passing structure by value > 12 bytes (3*sizeof(int)) */
 
 /* juce MIDI send functions have 1-based channel, so does rsj::MidiMessageId */
@@ -35,14 +34,17 @@ class MidiSender {
  public:
    explicit MidiSender(Devices& devices) noexcept : devices_(devices) {}
    void RescanDevices();
-   void Send(rsj::MidiMessageId id, int value) const;
+   /* device selects the output(s) sharing that device's name. If none is open, or device is
+    * kAnyDevice, the message goes to all outputs */
+   void Send(rsj::MidiMessageId id, int value, rsj::DeviceId device = rsj::kAnyDevice) const;
    void Start();
 
  private:
+   template<class F> void ForEachTarget(rsj::DeviceId device, F&& send) const;
    void InitDevices();
    Devices& devices_;
 
-   std::vector<std::unique_ptr<juce::MidiOutput>> output_devices_;
+   std::vector<std::pair<rsj::DeviceId, std::unique_ptr<juce::MidiOutput>>> output_devices_;
 };
 
 #endif
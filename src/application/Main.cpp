@@ -15,8 +15,11 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <exception>
+#include <functional>
 #include <fstream>
+#include <iostream>
 #include <memory>
 #include <mutex>
 #ifdef __cpp_lib_atomic_wait
@@ -47,15 +50,20 @@ namespace fs = std::filesystem;
 
 #include <JuceHeader.h>
 
+#include "AllocationAccounting.h"
+#include "AsyncLogger.h"
+#include "Benchmarks.h"
 #include "CCoptions.h"
 #include "CommandSet.h"
 #include "ControlsModel.h"
 #include "Devices.h"
+#include "FlightRecorder.h"
 #include "LR_IPC_In.h"
 #include "LR_IPC_Out.h"
 #include "MIDIReceiver.h"
 #include "MIDISender.h"
 #include "MainWindow.h"
+#include "Metrics.h"
 #include "Misc.h"
 #include "PWoptions.h"
 #include "Profile.h"
@@ -63,8 +71,6 @@ namespace fs = std::filesystem;
 #include "SettingsManager.h"
 #include "VersionChecker.h"
 #ifdef _WIN32
-#include <array>
-
 #include <wil/result.h> /* including too early causes conflicts with other windows includes */
 #endif
 
@@ -78,9 +84,30 @@ namespace {
    };
 
    constexpr auto kShutDownString {"--LRSHUTDOWN"};
+   constexpr auto kBenchmarkOption {"--benchmark"};
+   constexpr auto kJsonOption {"--json"};
+   constexpr auto kOutOption {"--out"};
+   constexpr auto kRecordOption {"--record"};
+   constexpr auto kReplayOption {"--replay"};
+   constexpr auto kSpeedOption {"--speed"};
+   constexpr auto kQuitAfterReplayOption {"--quit-after-replay"};
+   constexpr auto kAllocCheckOption {"--alloc-check"};
+   constexpr auto kProfileOption {"--profile"};
+   constexpr int kReplayDrainMs {500}; /* for the pipeline to empty after a replay */
+   /* controller input to Lightroom and Lightroom's values back to the controllers, which should
+    * allocate nothing once warmed up. MIDI output itself is left to the platform */
+   constexpr std::array<gsl::czstring<>, 5> kAllocationFreeScopes {"MidiReceiver input",
+       "MidiReceiver dispatch", "LrIpcOut write", "LrIpcIn read", "LrIpcIn line"};
    constexpr auto kSettingsFileX {"settings.xml"};
    constexpr auto kDefaultsFile {"default.xml"};
 
+   /* the argument following option, or empty if option isn't there */
+   juce::String OptionValue(const juce::StringArray& args, const char* option)
+   {
+      const auto index {args.indexOf(option)};
+      return index >= 0 && index + 1 < args.size() ? args[index + 1].unquoted() : juce::String {};
+   }
+
    class UpdateCurrentLogger {
     public:
       explicit UpdateCurrentLogger(juce::Logger* new_logger) noexcept
@@ -127,6 +154,7 @@ namespace {
       }
       catch (...) { //-V565
       }
+      rsj::FlushLog(); /* _Exit skips the log thread's shutdown */
       std::_Exit(EXIT_FAILURE);
    }
 /* global to install prior to program start order of initialization unimportant for this global
@@ -163,6 +191,11 @@ class MIDI2LRApplication final : public juce::JUCEApplication {
           * run. */
          if (command_line != kShutDownString) {
             MIDI2LR_FAST_FLOATS;
+            if (juce::StringArray::fromTokens(command_line, true).contains(kBenchmarkOption)) {
+               RunBenchmarks(command_line);
+               quit();
+               return;
+            }
             CCoptions::LinkToControlsModel(&controls_model_);
             PWoptions::LinkToControlsModel(&controls_model_);
             juce::LookAndFeel::setDefaultLookAndFeel(&look_feel_);
@@ -173,11 +206,14 @@ class MIDI2LRApplication final : public juce::JUCEApplication {
              * receive messages */
             main_window_ =
                 std::make_unique<MainWindow>(getApplicationName(), command_set_, profile_,
-                    profile_manager_, settings_manager_, lr_ipc_out_, midi_receiver_, midi_sender_);
+                    profile_manager_, settings_manager_, lr_ipc_in_, lr_ipc_out_, midi_receiver_,
+                    midi_sender_);
             midi_receiver_.Start();
             midi_sender_.Start();
             lr_ipc_out_.Start();
             lr_ipc_in_.Start();
+            metrics_recorder_.Start();
+            StartSessionTools(command_line);
             /* Check for latest version */
             version_checker_.Start();
          }
@@ -203,15 +239,27 @@ class MIDI2LRApplication final : public juce::JUCEApplication {
        * destroyed, 2) stop additional threads in VersionChecker, LR_IPC_In, LR_IPC_Out and
        * MIDIReceiver. Add to this list if new threads or callback lists are developed in this
        * app. */
+      if (!main_window_) {
+         /* nothing was started: benchmark run or shutdown request */
+         rsj::StopLogThread();
+         juce::Logger::setCurrentLogger(nullptr);
+         return;
+      }
       midi_receiver_.Stop();
       lr_ipc_in_.Stop();
       lr_ipc_out_.Stop();
       version_checker_.Stop();
+      metrics_recorder_.Stop();
       DefaultProfileSave();
       SaveControlsModel();
       settings_manager_.SetDefaultProfile(main_window_->GetProfileName());
       /* (delete our window) */
       main_window_.reset();
+      rsj::DumpTrace(rsj::DefaultTraceFile());
+      if constexpr (rsj::kAllocAccounting)
+         for (const auto& line : rsj::AllocationReport()) rsj::Log(line);
+      /* flush queued log lines while the FileLogger still exists */
+      rsj::StopLogThread();
       juce::Logger::setCurrentLogger(nullptr);
    }
 
@@ -384,6 +432,94 @@ class MIDI2LRApplication final : public juce::JUCEApplication {
       }
    }
 
+   /* --record <file>: record the MIDI session. --replay <file> [--speed <n>]
+    * [--quit-after-replay]: play a recording in place of the devices, speed 0 being as fast as
+    * possible. --profile <file>: switch to that profile first, so a replay can run with a known
+    * mapping */
+   void StartSessionTools(const juce::String& command_line)
+   {
+      try {
+         const auto args {juce::StringArray::fromTokens(command_line, true)};
+         const auto cwd {juce::File::getCurrentWorkingDirectory()};
+         if (const auto profile {OptionValue(args, kProfileOption)}; profile.isNotEmpty())
+            profile_manager_.SwitchToProfile(cwd.getChildFile(profile).getFullPathName());
+         if (const auto record {OptionValue(args, kRecordOption)}; record.isNotEmpty())
+            midi_receiver_.StartRecording(cwd.getChildFile(record));
+         if (const auto replay {OptionValue(args, kReplayOption)}; replay.isNotEmpty()) {
+            const auto speed_text {OptionValue(args, kSpeedOption)};
+            const auto speed {
+                speed_text.isEmpty() ? 1.0 : std::max(0.0, speed_text.getDoubleValue())};
+            if (args.contains(kAllocCheckOption)) {
+               StartAllocationCheck(cwd.getChildFile(replay), speed);
+               return;
+            }
+            std::function<void()> on_done {};
+            if (args.contains(kQuitAfterReplayOption))
+               on_done = [] {
+                  juce::MessageManager::callAsync([] { juce::JUCEApplication::quit(); });
+               };
+            midi_receiver_.Replay(cwd.getChildFile(replay), speed, std::move(on_done));
+         }
+      }
+      catch (const std::exception& e) {
+         MIDI2LR_E_RESPONSE;
+      }
+   }
+
+   /* --replay file --alloc-check: replays the session once to warm up, then again with the counts
+    * reset, and quits with exit code 1 unless kAllocationFreeScopes made no allocations the second
+    * time. Needs Lightroom or tools/lrsim listening, or LrIpcOut just holds the values. Only
+    * builds with MIDI2LR_ALLOC_ACCOUNTING can pass. tools/alloccheck has a session, a profile
+    * and a script to run it */
+   void StartAllocationCheck(const juce::File& file, const double speed)
+   {
+      try {
+         const auto after_replay {[](std::function<void()> next) {
+            return [next = std::move(next)] {
+               juce::MessageManager::callAsync(
+                   [next] { juce::Timer::callAfterDelay(kReplayDrainMs, next); });
+            };
+         }};
+         midi_receiver_.Replay(file, speed, after_replay([this, file, speed, after_replay] {
+            rsj::ResetAllocationCounts();
+            midi_receiver_.Replay(file, speed, after_replay([] {
+               for (const auto& line : rsj::AllocationReport()) rsj::Log(line);
+               const auto passed {rsj::CheckAllocationFree(kAllocationFreeScopes)};
+               juce::JUCEApplication::getInstance()->setApplicationReturnValue(passed ? 0 : 1);
+               juce::JUCEApplication::quit();
+            }));
+         }));
+      }
+      catch (const std::exception& e) {
+         MIDI2LR_E_RESPONSE;
+      }
+   }
+
+   /* --benchmark [--json] [--out file]: print the engine benchmarks and save them to file,
+    * MIDI2LR_benchmarks.txt or .json in the current directory by default */
+   void RunBenchmarks(const juce::String& command_line) const
+   {
+      try {
+         const auto args {juce::StringArray::fromTokens(command_line, true)};
+         const auto json {args.contains(kJsonOption)};
+         auto name {OptionValue(args, kOutOption)};
+         if (name.isEmpty())
+            name = json ? "MIDI2LR_benchmarks.json" : "MIDI2LR_benchmarks.txt";
+         const auto file {juce::File::getCurrentWorkingDirectory().getChildFile(name)};
+         const auto report {rsj::FormatBenchmarks(rsj::RunBenchmarks(command_set_), json)};
+         std::cout << report << std::flush;
+         if (file.replaceWithText(report))
+            rsj::Log(fmt::format(FMT_STRING("Benchmark results written to {}."),
+                file.getFullPathName().toStdString()));
+         else
+            rsj::Log(fmt::format(FMT_STRING("Unable to write benchmark results to {}."),
+                file.getFullPathName().toStdString()));
+      }
+      catch (const std::exception& e) {
+         MIDI2LR_E_RESPONSE;
+      }
+   }
+
    void SetAppFont() const
    {
       /* juce (as of July 2018) uses the following font defaults taken from juce_mac_Fonts.mm and
@@ -455,11 +591,12 @@ class MIDI2LRApplication final : public juce::JUCEApplication {
    ControlsModel controls_model_ {};
    Profile profile_ {command_set_};
    MidiSender midi_sender_ {devices_};
-   MidiReceiver midi_receiver_ {devices_};
+   MidiReceiver midi_receiver_ {devices_, controls_model_};
    LrIpcOut lr_ipc_out_ {command_set_, controls_model_, profile_, midi_sender_, midi_receiver_};
    ProfileManager profile_manager_ {controls_model_, profile_, lr_ipc_out_, midi_receiver_};
-   LrIpcIn lr_ipc_in_ {controls_model_, profile_manager_, profile_, midi_sender_};
+   LrIpcIn lr_ipc_in_ {controls_model_, profile_manager_, profile_, midi_sender_, lr_ipc_out_};
    SettingsManager settings_manager_ {profile_manager_, lr_ipc_out_};
+   MetricsRecorder metrics_recorder_ {};
    std::unique_ptr<MainWindow> main_window_ {nullptr};
    /* destroy after window that uses it */
    LookAndFeelMIDI2LR look_feel_;
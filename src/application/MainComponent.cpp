@@ -22,6 +22,7 @@
 #include <fmt/format.h>
 #include <gsl/gsl>
 
+#include "LR_IPC_In.h"
 #include "LR_IPC_Out.h"
 #include "MIDIReceiver.h"
 #include "MIDISender.h"
@@ -31,6 +32,7 @@
 #include "ProfileManager.h"
 #include "SettingsComponent.h"
 #include "SettingsManager.h"
+#include "StatsComponent.h"
 
 namespace {
    constexpr int kMainWidth {560}; /* equals CommandTable columns total width plus 60 */
@@ -56,16 +58,39 @@ namespace {
    constexpr int kBottomButtonY {kMainHeight - kBottomSectionHeight + 135};
    constexpr int kBottomButtonY2 {kMainHeight - kBottomSectionHeight + 160};
    constexpr auto kDefaultsFile {"default.xml"};
+   constexpr int kDisplayHz {30};
+   constexpr int kHighlightTicks {kDisplayHz}; /* one second */
+
+   /* fits a MidiMessage into one lock-free word: value and control number take 14 bits each,
+    * channel and type 4 each, the device the rest. The top bit marks the slot as filled */
+   constexpr std::uint64_t kFilled {1ULL << 63};
+
+   [[nodiscard]] std::uint64_t PackMessage(const rsj::MidiMessage& mm) noexcept
+   {
+      return kFilled | static_cast<std::uint64_t>(mm.device & 0x7FFFFFF) << 36
+             | static_cast<std::uint64_t>(mm.message_type_byte) << 32
+             | static_cast<std::uint64_t>(mm.channel & 0xF) << 28
+             | static_cast<std::uint64_t>(mm.control_number & 0x3FFF) << 14
+             | static_cast<std::uint64_t>(mm.value & 0x3FFF);
+   }
+
+   [[nodiscard]] rsj::MidiMessage UnpackMessage(const std::uint64_t packed) noexcept
+   {
+      return {static_cast<rsj::MessageType>(packed >> 32 & 0xF),
+          static_cast<int>(packed >> 28 & 0xF), static_cast<int>(packed >> 14 & 0x3FFF),
+          static_cast<int>(packed & 0x3FFF), static_cast<rsj::DeviceId>(packed >> 36 & 0x7FFFFFF)};
+   }
 } // namespace
 
 MainContentComponent::MainContentComponent(const CommandSet& command_set, Profile& profile,
-    ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcOut& lr_ipc_out,
-    MidiReceiver& midi_receiver, MidiSender& midi_sender)
+    ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcIn& lr_ipc_in,
+    LrIpcOut& lr_ipc_out, MidiReceiver& midi_receiver, MidiSender& midi_sender)
 try : ResizableLayout {
    this
 }
-, command_table_model_(command_set, profile), lr_ipc_out_ {lr_ipc_out},
-    midi_receiver_ {midi_receiver}, midi_sender_ {midi_sender}, profile_(profile),
+, command_table_model_(command_set, profile), lr_ipc_in_ {lr_ipc_in},
+    lr_ipc_out_ {lr_ipc_out}, midi_receiver_ {midi_receiver}, midi_sender_ {midi_sender},
+    profile_(profile),
     profile_manager_(profile_manager), settings_manager_(settings_manager)
 {
    setSize(kMainWidth, kMainHeight);
@@ -161,10 +186,9 @@ void MainContentComponent::Init()
          juce::DialogWindow::LaunchOptions dialog_options;
          dialog_options.dialogTitle = juce::translate("Settings");
          /* create new object */
-         auto component {std::make_unique<SettingsComponent>(settings_manager_)};
+         auto component {std::make_unique<SettingsComponent>(settings_manager_, midi_receiver_)};
          component->Init();
-         dialog_options.content.setOwned(component.release());
-         dialog_options.content->setSize(400, 300);
+         dialog_options.content.setOwned(component.release()); /* sized by Init */
          settings_dialog_.reset(dialog_options.create());
          settings_dialog_->setVisible(true);
       };
@@ -209,7 +233,7 @@ void MainContentComponent::Init()
          midi_receiver_.RescanDevices();
          midi_sender_.RescanDevices();
          /* Send new CC parameters to MIDI Out devices */
-         lr_ipc_out_.SendCommand("FullRefresh 1\n");
+         lr_ipc_in_.Resync();
       };
 
       /* Disconnect button */
@@ -238,6 +262,21 @@ void MainContentComponent::Init()
          command_table_.updateContent();
       };
 
+      /* Statistics */
+      stats_button_.setBounds(kSecondButtonX, kBottomButtonY2, kButtonWidth, kStandardHeight);
+      addToLayout(&stats_button_, anchorMidLeft, anchorMidRight);
+      addAndMakeVisible(stats_button_);
+      stats_button_.onClick = [this] {
+         juce::DialogWindow::LaunchOptions dialog_options;
+         dialog_options.dialogTitle = juce::translate("Statistics");
+         auto component {std::make_unique<StatsComponent>()};
+         component->Init();
+         dialog_options.content.setOwned(component.release());
+         dialog_options.resizable = true;
+         stats_dialog_.reset(dialog_options.create());
+         stats_dialog_->setVisible(true);
+      };
+
       /* Try to load a default.xml if the user has not set a profile directory */
       if (settings_manager_.GetProfileDirectory().isEmpty()) {
          const auto filename {rsj::AppDataFilePath(kDefaultsFile)};
@@ -258,6 +297,7 @@ void MainContentComponent::Init()
 
       /* turn it on */
       activateLayout();
+      startTimerHz(kDisplayHz);
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -291,14 +331,10 @@ void MainContentComponent::paint(juce::Graphics& g)
 void MainContentComponent::MidiCmdCallback(const rsj::MidiMessage& mm)
 {
    try {
-      /* Display the MIDI parameters and add/highlight row in table corresponding to the message msg
-       * is 1-based for channel, which display expects */
-      const rsj::MidiMessageId msg {mm};
-      last_command_ = fmt::format(FMT_STRING("{}: {}{} [{}]"), msg.channel, mm.message_type_byte,
-          msg.control_number, mm.value);
-      profile_.AddRowUnmapped(msg);
-      row_to_select_ = gsl::narrow_cast<size_t>(profile_.GetRowForMessage(msg));
-      triggerAsyncUpdate();
+      /* add a row for a new message here, so none are missed, but leave the display to the timer */
+      if (profile_.AddRowUnmapped(rsj::MidiMessageId {mm}, mm.device))
+         rows_added_.store(true, std::memory_order_release);
+      last_message_.store(PackMessage(mm), std::memory_order_release);
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -306,12 +342,26 @@ void MainContentComponent::MidiCmdCallback(const rsj::MidiMessage& mm)
    }
 }
 
+/* called on the LrIpcOut threads, which must not wait for the message loop. The label is brought
+ * up to date in handleAsyncUpdate; if several changes come first, only the last is shown */
 void MainContentComponent::LrIpcOutCallback(const bool connected, const bool sending_blocked)
 {
    try {
-      const juce::MessageManagerLock mm_lock; /* as not called in message loop */
-      if (connected) {
-         if (sending_blocked) {
+      sending_blocked_.store(sending_blocked, std::memory_order_release);
+      connected_.store(connected, std::memory_order_release);
+      triggerAsyncUpdate();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void MainContentComponent::handleAsyncUpdate()
+{
+   try {
+      if (connected_.load(std::memory_order_acquire)) {
+         if (sending_blocked_.load(std::memory_order_acquire)) {
             connection_label_.setText(
                 juce::translate("Sending halted"), juce::NotificationType::dontSendNotification);
             connection_label_.setColour(juce::Label::backgroundColourId, juce::Colours::yellow);
@@ -337,18 +387,23 @@ void MainContentComponent::LrIpcOutCallback(const bool connected, const bool sen
 
 #pragma warning(suppress : 26461) /* must not change function signature, used as callback */
 void MainContentComponent::ProfileChanged(
-    juce::XmlElement* xml_element, const juce::String& file_name)
+    const Profile::ContentsPtr& contents, const juce::String& file_name)
 { //-V2009 overridden method
    try {
-      {
-         const juce::MessageManagerLock mm_lock;
-         profile_.FromXml(xml_element);
-         command_table_.updateContent();
-         command_table_.repaint();
-         profile_name_label_.setText(file_name, juce::NotificationType::dontSendNotification);
-      }
+      /* Profile has its own lock, so the switch takes effect at once. Only the display waits for
+       * the message thread */
+      profile_.Assign(contents);
+      juce::MessageManager::callAsync(
+          [safe_this = juce::Component::SafePointer<MainContentComponent> {this}, file_name] {
+             if (auto* const component {safe_this.getComponent()}) {
+                component->command_table_.updateContent();
+                component->command_table_.repaint();
+                component->profile_name_label_.setText(
+                    file_name, juce::NotificationType::dontSendNotification);
+             }
+          });
       /* Send new CC parameters to MIDI Out devices */
-      lr_ipc_out_.SendCommand("FullRefresh 1\n");
+      lr_ipc_in_.Resync();
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -369,29 +424,28 @@ void MainContentComponent::StandardLabelSettings(juce::Label& label_to_set)
    }
 }
 
-void MainContentComponent::handleAsyncUpdate()
-{
-   try {
-      /* Update the last command label and set its color to green */
-      command_label_.setText(last_command_, juce::NotificationType::dontSendNotification);
-      command_label_.setColour(juce::Label::backgroundColourId, juce::Colours::greenyellow);
-      startTimer(1000);
-      /* Update the command table to add and/or select row corresponding to midi command */
-      command_table_.updateContent();
-      command_table_.selectRow(gsl::narrow_cast<int>(row_to_select_));
-   }
-   catch (const std::exception& e) {
-      MIDI2LR_E_RESPONSE;
-      throw;
-   }
-}
-
+/* runs at display rate, so a fader sweep costs one label and table update per frame rather than
+ * one per message */
 void MainContentComponent::timerCallback()
 {
    try {
-      /* reset the command label's background to white */
-      command_label_.setColour(juce::Label::backgroundColourId, juce::Colours::white);
-      juce::Timer::stopTimer();
+      if (const auto packed {last_message_.exchange(0, std::memory_order_acq_rel)}) {
+         /* Display the MIDI parameters and highlight the row corresponding to the message. msg is
+          * 1-based for channel, which display expects */
+         const auto mm {UnpackMessage(packed)};
+         const rsj::MidiMessageId msg {mm};
+         command_label_.setText(fmt::format(FMT_STRING("{}: {}{} [{}]"), msg.channel,
+                                    mm.message_type_byte, msg.control_number, mm.value),
+             juce::NotificationType::dontSendNotification);
+         command_label_.setColour(juce::Label::backgroundColourId, juce::Colours::greenyellow);
+         highlight_ticks_ = kHighlightTicks;
+         if (rows_added_.exchange(false, std::memory_order_acq_rel))
+            command_table_.updateContent();
+         command_table_.selectRow(profile_.GetRowForMessage(msg));
+      }
+      else if (highlight_ticks_ > 0 && --highlight_ticks_ == 0)
+         /* reset the command label's background to white */
+         command_label_.setColour(juce::Label::backgroundColourId, juce::Colours::white);
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -15,6 +15,8 @@
  * see <http://www.gnu.org/licenses/>.
  *
  */
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
 #include <juce_core/juce_core.h>
@@ -26,6 +28,7 @@
 #include "CommandTableModel.h"
 #include "falco/ResizableLayout.h"
 class CommandSet;
+class LrIpcIn;
 class LrIpcOut;
 class MidiReceiver;
 class MidiSender;
@@ -43,8 +46,8 @@ class MainContentComponent final :
     public ResizableLayout {
  public:
    MainContentComponent(const CommandSet& command_set, Profile& profile,
-       ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcOut& lr_ipc_out,
-       MidiReceiver& midi_receiver, MidiSender& midi_sender);
+       ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcIn& lr_ipc_in,
+       LrIpcOut& lr_ipc_out, MidiReceiver& midi_receiver, MidiSender& midi_sender);
    ~MainContentComponent() = default; // NOLINT(modernize-use-override)
    MainContentComponent(const MainContentComponent& other) = delete;
    MainContentComponent(MainContentComponent&& other) = delete;
@@ -59,7 +62,7 @@ class MainContentComponent final :
    void LrIpcOutCallback(bool, bool);
    void MidiCmdCallback(const rsj::MidiMessage&);
    void paint(juce::Graphics&) override;
-   void ProfileChanged(juce::XmlElement* xml_element, const juce::String& file_name);
+   void ProfileChanged(const Profile::ContentsPtr& contents, const juce::String& file_name);
    void StandardLabelSettings(juce::Label& label_to_set);
    void timerCallback() override;
 
@@ -72,7 +75,6 @@ class MainContentComponent final :
    juce::Label title_label_ {"Title", "MIDI2LR"};
    juce::Label version_label_ {
        "Version", juce::translate("Version ") + juce::String {ProjectInfo::versionString}};
-   juce::String last_command_;
    juce::TextButton disconnect_button_ {juce::translate("Halt sending to Lightroom")};
    juce::TextButton load_button_ {juce::translate("Load")};
    juce::TextButton remove_row_button_ {juce::translate("Clear ALL rows")};
@@ -80,14 +82,24 @@ class MainContentComponent final :
    juce::TextButton rescan_button_ {juce::translate("Rescan MIDI devices")};
    juce::TextButton save_button_ {juce::translate("Save")};
    juce::TextButton settings_button_ {juce::translate("Settings")};
+   juce::TextButton stats_button_ {juce::translate("Statistics")};
+   LrIpcIn& lr_ipc_in_;
    LrIpcOut& lr_ipc_out_;
    MidiReceiver& midi_receiver_;
    MidiSender& midi_sender_;
    Profile& profile_;
    ProfileManager& profile_manager_;
    SettingsManager& settings_manager_;
-   size_t row_to_select_ {0};
+   /* latest MIDI message in learn mode, packed by PackMessage. The MIDI thread only stores it
+    * and the display timer picks it up */
+   std::atomic<std::uint64_t> last_message_ {0};
+   std::atomic<bool> rows_added_ {false};
+   /* set by LrIpcOutCallback on the IO threads, shown by handleAsyncUpdate */
+   std::atomic<bool> connected_ {false};
+   std::atomic<bool> sending_blocked_ {false};
+   int highlight_ticks_ {0}; /* display timer ticks left before the command label turns white */
    std::unique_ptr<juce::DialogWindow> settings_dialog_;
+   std::unique_ptr<juce::DialogWindow> stats_dialog_;
 };
 
 #endif
\ No newline at end of file
@@ -20,13 +20,13 @@
 #include "SettingsManager.h"
 
 MainWindow::MainWindow(const juce::String& name, const CommandSet& command_set, Profile& profile,
-    ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcOut& lr_ipc_out,
-    MidiReceiver& midi_receiver, MidiSender& midi_sender)
+    ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcIn& lr_ipc_in,
+    LrIpcOut& lr_ipc_out, MidiReceiver& midi_receiver, MidiSender& midi_sender)
 try : juce
    ::DocumentWindow {name, juce::Colours::lightgrey,
        juce::DocumentWindow::minimiseButton | juce::DocumentWindow::closeButton},
        window_content_ {std::make_unique<MainContentComponent>(command_set, profile,
-           profile_manager, settings_manager, lr_ipc_out, midi_receiver, midi_sender)}
+           profile_manager, settings_manager, lr_ipc_in, lr_ipc_out, midi_receiver, midi_sender)}
    {
       juce::TopLevelWindow::setUsingNativeTitleBar(true);
       juce::ResizableWindow::setContentNonOwned(window_content_.get(), true);
@@ -24,6 +24,7 @@
 #include "MainComponent.h"
 
 class CommandSet;
+class LrIpcIn;
 class LrIpcOut;
 class MidiReceiver;
 class MidiSender;
@@ -34,8 +35,8 @@ class SettingsManager;
 class MainWindow final : juce::DocumentWindow, juce::Timer {
  public:
    MainWindow(const juce::String& name, const CommandSet& command_set, Profile& profile,
-       ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcOut& lr_ipc_out,
-       MidiReceiver& midi_receiver, MidiSender& midi_sender);
+       ProfileManager& profile_manager, SettingsManager& settings_manager, LrIpcIn& lr_ipc_in,
+       LrIpcOut& lr_ipc_out, MidiReceiver& midi_receiver, MidiSender& midi_sender);
    ~MainWindow() = default; // NOLINT(modernize-use-override)
    MainWindow(const MainWindow& other) = delete;
    MainWindow(MainWindow&& other) = delete;
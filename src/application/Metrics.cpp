@@ -0,0 +1,261 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iterator>
+
+#include <fmt/format.h>
+
+#include "Misc.h"
+
+namespace {
+   constexpr int kCsvTicks {60};                            /* seconds between CSV rows */
+   constexpr juce::int64 kCsvMaxBytes {10 * 1024 * 1024}; /* start over past this */
+   constexpr auto kCsvHeader {"time,metric,value,per_second,p50_us,p90_us,p99_us,max_us\n"};
+
+   std::string CsvQuote(const std::string& in)
+   {
+      std::string out {"\""};
+      for (const auto c : in) {
+         if (c == '"')
+            out.push_back('"');
+         out.push_back(c);
+      }
+      out.push_back('"');
+      return out;
+   }
+} // namespace
+
+void rsj::Histogram::Record(const std::uint64_t value) noexcept
+{
+   buckets_[BucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+   auto max {max_.load(std::memory_order_relaxed)};
+   while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+std::uint64_t rsj::Histogram::Count() const noexcept
+{
+   std::uint64_t count {0};
+   for (const auto& bucket : buckets_) count += bucket.load(std::memory_order_relaxed);
+   return count;
+}
+
+std::uint64_t rsj::Histogram::Percentile(const double percent) const noexcept
+{
+   const auto count {Count()};
+   if (count == 0)
+      return 0;
+   const auto target {std::max(
+       std::uint64_t {1}, static_cast<std::uint64_t>(std::ceil(count * percent / 100.0)))};
+   std::uint64_t seen {0};
+   for (std::size_t i {0}; i < kBuckets; ++i) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+      if (seen >= target)
+         return std::min(BucketTop(i), Max());
+   }
+   return Max();
+}
+
+std::size_t rsj::Histogram::BucketFor(const std::uint64_t value) noexcept
+{
+   if (value < kSubBuckets)
+      return static_cast<std::size_t>(value);
+   unsigned msb {0};
+   for (auto v {value}; v >>= 1;) ++msb;
+   const auto shift {msb - kSubBits};
+   return (shift + 1) * kSubBuckets + static_cast<std::size_t>((value >> shift) - kSubBuckets);
+}
+
+std::uint64_t rsj::Histogram::BucketTop(const std::size_t bucket) noexcept
+{
+   if (bucket < kSubBuckets)
+      return bucket;
+   const auto shift {bucket / kSubBuckets - 1};
+   const std::uint64_t sub {bucket % kSubBuckets + kSubBuckets};
+   return ((sub + 1) << shift) - 1;
+}
+
+rsj::Counter& rsj::MetricsRegistry::GetCounter(const std::string& name)
+{
+   try {
+      auto lock {std::scoped_lock(mutex_)};
+      auto& entry {counters_[name]};
+      if (!entry)
+         entry = std::make_unique<CounterEntry>();
+      return entry->counter;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+rsj::Gauge& rsj::MetricsRegistry::GetGauge(const std::string& name)
+{
+   try {
+      auto lock {std::scoped_lock(mutex_)};
+      auto& gauge {gauges_[name]};
+      if (!gauge)
+         gauge = std::make_unique<Gauge>();
+      return *gauge;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+rsj::Histogram& rsj::MetricsRegistry::GetHistogram(const std::string& name)
+{
+   try {
+      auto lock {std::scoped_lock(mutex_)};
+      auto& histogram {histograms_[name]};
+      if (!histogram)
+         histogram = std::make_unique<Histogram>();
+      return *histogram;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void rsj::MetricsRegistry::Tick()
+{
+   try {
+      auto lock {std::scoped_lock(mutex_)};
+      const auto now {std::chrono::steady_clock::now()};
+      const auto seconds {std::chrono::duration<double>(now - last_tick_).count()};
+      last_tick_ = now;
+      if (seconds <= 0.0)
+         return;
+      for (auto& [name, entry] : counters_) {
+         const auto value {entry->counter.Get()};
+         entry->per_second = static_cast<double>(value - entry->last) / seconds;
+         entry->last = value;
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+std::vector<std::string> rsj::MetricsRegistry::ReportLines() const
+{
+   try {
+      auto lock {std::scoped_lock(mutex_)};
+      std::vector<std::string> lines {};
+      for (const auto& [name, histogram] : histograms_)
+         lines.push_back(fmt::format(
+             FMT_STRING("{}: n={} p50={:.2f}ms p90={:.2f}ms p99={:.2f}ms max={:.2f}ms"), name,
+             histogram->Count(), histogram->Percentile(50.0) / 1000.0,
+             histogram->Percentile(90.0) / 1000.0, histogram->Percentile(99.0) / 1000.0,
+             histogram->Max() / 1000.0));
+      for (const auto& [name, entry] : counters_)
+         lines.push_back(fmt::format(
+             FMT_STRING("{}: {} ({:.1f}/s)"), name, entry->counter.Get(), entry->per_second));
+      for (const auto& [name, gauge] : gauges_)
+         lines.push_back(fmt::format(FMT_STRING("{}: {}"), name, gauge->Get()));
+      return lines;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void rsj::MetricsRegistry::AppendCsv(const juce::File& file) const
+{
+   try {
+      if (file.getSize() > kCsvMaxBytes)
+         file.deleteFile();
+      std::string rows {file.existsAsFile() ? "" : kCsvHeader};
+      auto rows_it {std::back_inserter(rows)};
+      const auto time {juce::Time::getCurrentTime().toISO8601(true).toStdString()};
+      {
+         auto lock {std::scoped_lock(mutex_)};
+         for (const auto& [name, histogram] : histograms_)
+            fmt::format_to(rows_it, FMT_STRING("{},{},{},,{},{},{},{}\n"), time, CsvQuote(name),
+                histogram->Count(), histogram->Percentile(50.0), histogram->Percentile(90.0),
+                histogram->Percentile(99.0), histogram->Max());
+         for (const auto& [name, entry] : counters_)
+            fmt::format_to(rows_it, FMT_STRING("{},{},{},{:.2f},,,,\n"), time, CsvQuote(name),
+                entry->counter.Get(), entry->per_second);
+         for (const auto& [name, gauge] : gauges_)
+            fmt::format_to(
+                rows_it, FMT_STRING("{},{},{},,,,,\n"), time, CsvQuote(name), gauge->Get());
+      }
+      if (!file.appendText(juce::String::fromUTF8(rows.data(), gsl::narrow<int>(rows.size())),
+              false, false, "\n"))
+         rsj::Log(fmt::format(
+             FMT_STRING("Unable to write metrics to {}."), file.getFullPathName().toStdString()));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+rsj::MetricsRegistry& rsj::Metrics()
+{
+   static MetricsRegistry metrics {};
+   return metrics;
+}
+
+void MetricsRecorder::Start()
+{
+   try {
+      csv_file_ = rsj::LogFolderFile("MIDI2LR_metrics.csv");
+      startTimer(1000);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void MetricsRecorder::Stop()
+{
+   try {
+      stopTimer();
+      rsj::Metrics().Tick();
+      rsj::Metrics().AppendCsv(csv_file_);
+      for (const auto& line : rsj::Metrics().ReportLines()) rsj::Log("Metrics: " + line);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void MetricsRecorder::timerCallback()
+{
+   try {
+      rsj::Metrics().Tick();
+      if (++ticks_ >= kCsvTicks) {
+         ticks_ = 0;
+         rsj::Metrics().AppendCsv(csv_file_);
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
@@ -0,0 +1,141 @@
+#ifndef MIDI2LR_METRICS_H_INCLUDED
+#define MIDI2LR_METRICS_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+
+namespace rsj {
+   class Counter {
+    public:
+      void Add(std::uint64_t n = 1) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+      [[nodiscard]] std::uint64_t Get() const noexcept
+      {
+         return value_.load(std::memory_order_relaxed);
+      }
+
+    private:
+      std::atomic<std::uint64_t> value_ {0};
+   };
+
+   class Gauge {
+    public:
+      void Add(std::int64_t n) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+      void Set(std::int64_t value) noexcept { value_.store(value, std::memory_order_relaxed); }
+      [[nodiscard]] std::int64_t Get() const noexcept
+      {
+         return value_.load(std::memory_order_relaxed);
+      }
+
+    private:
+      std::atomic<std::int64_t> value_ {0};
+   };
+
+   /* Log-linear buckets as in HdrHistogram: eight per power of two, so a reported percentile is
+    * within 12.5% of the recorded value. Recording is lock-free; values are microseconds by
+    * convention. */
+   class Histogram {
+    public:
+      void Record(std::uint64_t value) noexcept;
+      [[nodiscard]] std::uint64_t Count() const noexcept;
+      [[nodiscard]] std::uint64_t Max() const noexcept
+      {
+         return max_.load(std::memory_order_relaxed);
+      }
+      [[nodiscard]] std::uint64_t Percentile(double percent) const noexcept;
+
+    private:
+      static constexpr unsigned kSubBits {3};
+      static constexpr std::size_t kSubBuckets {1U << kSubBits};
+      static constexpr std::size_t kBuckets {(64 - kSubBits + 1) * kSubBuckets};
+      [[nodiscard]] static std::size_t BucketFor(std::uint64_t value) noexcept;
+      [[nodiscard]] static std::uint64_t BucketTop(std::size_t bucket) noexcept;
+      std::array<std::atomic<std::uint64_t>, kBuckets> buckets_ {};
+      std::atomic<std::uint64_t> max_ {0};
+   };
+
+   /* Named metrics for the whole app. Look a metric up once and keep the reference: lookups
+    * lock, updates don't. Names are "group.metric"; the group orders the report. */
+   class MetricsRegistry {
+    public:
+      MetricsRegistry() = default;
+      ~MetricsRegistry() = default;
+      MetricsRegistry(const MetricsRegistry& other) = delete;
+      MetricsRegistry(MetricsRegistry&& other) = delete;
+      MetricsRegistry& operator=(const MetricsRegistry& other) = delete;
+      MetricsRegistry& operator=(MetricsRegistry&& other) = delete;
+      /* created on first use, valid for the life of the program */
+      [[nodiscard]] Counter& GetCounter(const std::string& name);
+      [[nodiscard]] Gauge& GetGauge(const std::string& name);
+      [[nodiscard]] Histogram& GetHistogram(const std::string& name);
+      /* updates the per-second rate of every counter */
+      void Tick();
+      [[nodiscard]] std::vector<std::string> ReportLines() const;
+      void AppendCsv(const juce::File& file) const;
+
+    private:
+      struct CounterEntry {
+         Counter counter {};
+         std::uint64_t last {0};
+         double per_second {0.0};
+      };
+      mutable std::mutex mutex_ {};
+      std::map<std::string, std::unique_ptr<CounterEntry>> counters_ {};
+      std::map<std::string, std::unique_ptr<Gauge>> gauges_ {};
+      std::map<std::string, std::unique_ptr<Histogram>> histograms_ {};
+      std::chrono::steady_clock::time_point last_tick_ {std::chrono::steady_clock::now()};
+   };
+
+   [[nodiscard]] MetricsRegistry& Metrics();
+
+   /* microseconds since a juce::Time::getMillisecondCounterHiRes reading (in ms) */
+   [[nodiscard]] inline std::uint64_t MicrosecondsSince(double start_ms) noexcept
+   {
+      const auto elapsed {juce::Time::getMillisecondCounterHiRes() - start_ms};
+      return elapsed > 0.0 ? static_cast<std::uint64_t>(elapsed * 1000.0) : 0;
+   }
+} // namespace rsj
+
+/* Ticks the registry once a second and appends it to a CSV next to the log every minute */
+class MetricsRecorder final : juce::Timer {
+ public:
+   MetricsRecorder() = default;
+   ~MetricsRecorder() = default; // NOLINT(modernize-use-override)
+   MetricsRecorder(const MetricsRecorder& other) = delete;
+   MetricsRecorder(MetricsRecorder&& other) = delete;
+   MetricsRecorder& operator=(const MetricsRecorder& other) = delete;
+   MetricsRecorder& operator=(MetricsRecorder&& other) = delete;
+   void Start();
+   void Stop();
+
+ private:
+   void timerCallback() override;
+   juce::File csv_file_ {};
+   int ticks_ {0};
+};
+
+#endif
@@ -15,8 +15,10 @@
  */
 #include "MidiUtilities.h"
 
+#include <algorithm>
 #include <exception>
 #include <mutex>
+#include <vector>
 
 #include <fmt/format.h>
 #include <gsl/gsl>
@@ -24,10 +26,53 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 
 #include "Misc.h"
+/*****************************************************************************/
+/*************DeviceId********************************************************/
+/*****************************************************************************/
+namespace {
+   /* only touched when devices are opened and when profiles are loaded or saved, so a plain mutex
+    * is fine. index is the DeviceId; entry 0 is kAnyDevice */
+   std::mutex device_names_mutex;
+   std::vector<std::string> device_names {std::string {}};
+} // namespace
+
+rsj::DeviceId rsj::DeviceIdForName(const std::string& name)
+{
+   try {
+      if (name.empty())
+         return kAnyDevice;
+      auto lock {std::scoped_lock(device_names_mutex)};
+      const auto found {std::find(device_names.cbegin(), device_names.cend(), name)};
+      if (found != device_names.cend())
+         return gsl::narrow_cast<DeviceId>(found - device_names.cbegin());
+      device_names.push_back(name);
+      return gsl::narrow_cast<DeviceId>(device_names.size() - 1);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+std::string rsj::DeviceNameForId(const DeviceId id)
+{
+   try {
+      auto lock {std::scoped_lock(device_names_mutex)};
+      if (id <= kAnyDevice || rsj::cmp_greater_equal(id, device_names.size()))
+         return {};
+      return device_names.at(gsl::narrow_cast<size_t>(id));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
 /*****************************************************************************/
 /*************MidiMessage*****************************************************/
 /*****************************************************************************/
-rsj::MidiMessage::MidiMessage(const juce::MidiMessage& mm)
+rsj::MidiMessage::MidiMessage(const juce::MidiMessage& mm, const DeviceId dev)
+    : device {dev}, timestamp {mm.getTimeStamp()}
 {
    /* anything not set below is set to zero by default constructor */
 #pragma warning(push)
@@ -24,6 +24,7 @@
 #include <compare>
 #endif
 #include <stdexcept>
+#include <string>
 #include <type_traits>
 #include <typeindex> /*declaration of std::hash template*/
 
@@ -115,6 +116,22 @@ namespace fmt {
    };
 } // namespace fmt
 
+/*****************************************************************************/
+/*************DeviceId********************************************************/
+/*****************************************************************************/
+namespace rsj {
+   /* Compact stand-in for a controller's port name, so that messages can record where they came
+    * from and feedback can be sent back to the same controller. Ids are handed out on first use
+    * and never reused while the application runs. Ports with the same name share an id, so an
+    * input and the output of the same controller normally match. kAnyDevice is used when the
+    * source is unknown (e.g., profiles saved before devices were recorded), and means all outputs
+    * receive the feedback. */
+   using DeviceId = int;
+   inline constexpr DeviceId kAnyDevice {0};
+   [[nodiscard]] DeviceId DeviceIdForName(const std::string& name);
+   [[nodiscard]] std::string DeviceNameForId(DeviceId id);
+} // namespace rsj
+
 /*****************************************************************************/
 /*************MidiMessage*****************************************************/
 /*****************************************************************************/
@@ -125,20 +142,27 @@ namespace rsj {
       int channel {0}; /* 0-based */
       int control_number {0};
       int value {0};
+      DeviceId device {kAnyDevice}; /* input port the message arrived on */
+      /* arrival in seconds on the juce::Time::getMillisecondCounter clock, 0 if unknown. Not
+       * part of the message's identity */
+      double timestamp {0.0};
       constexpr MidiMessage() noexcept = default;
 
-      constexpr MidiMessage(MessageType mt, int ch, int nu, int va) noexcept
-          : message_type_byte(mt), channel(ch), control_number(nu), value(va)
+      constexpr MidiMessage(MessageType mt, int ch, int nu, int va, DeviceId dev = kAnyDevice,
+          double ts = 0.0) noexcept
+          : message_type_byte(mt), channel(ch), control_number(nu), value(va), device(dev),
+            timestamp(ts)
       {
       }
 
-      explicit MidiMessage(const juce::MidiMessage& mm);
+      explicit MidiMessage(const juce::MidiMessage& mm, DeviceId dev = kAnyDevice);
    };
 
    constexpr bool operator==(const rsj::MidiMessage& lhs, const rsj::MidiMessage& rhs) noexcept
    {
       return lhs.message_type_byte == rhs.message_type_byte && lhs.channel == rhs.channel
-             && lhs.control_number == rhs.control_number && lhs.value == rhs.value;
+             && lhs.control_number == rhs.control_number && lhs.value == rhs.value
+             && lhs.device == rhs.device;
    }
 
    /* channel is 0-based in MidiMessage, 1-based in MidiMessageId */
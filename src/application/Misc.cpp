@@ -30,6 +30,8 @@
 #include "Ocpp.h"
 #endif
 
+#include "AsyncLogger.h"
+
 /* XCode has issues with std:: in this file, using ::std:: to fix when necessary */
 /*****************************************************************************/
 /**************Thread Labels**************************************************/
@@ -112,13 +114,14 @@ void rsj::TrimL(::std::string_view& value) noexcept
 /*****************************************************************************/
 /**************Error Logging**************************************************/
 /*****************************************************************************/
+/* Log goes through the AsyncLogger ring. Errors are written synchronously, without the rate
+ * limit, before the alert is raised */
 #ifdef __cpp_lib_source_location
 void rsj::Log(const juce::String& info, const std::source_location& location) noexcept
 {
    try {
-      if (juce::Logger::getCurrentLogger())
-         juce::Logger::writeToLog(juce::Time::getCurrentTime().toISO8601(true) + ":"
-                                  + location.file_name() + ":" + location.line() + " " + info);
+      rsj::EnqueueLog(location.file_name(), location.line(),
+          {info.toRawUTF8(), info.getNumBytesAsUTF8()});
    }
    catch (...) { //-V565
    }
@@ -127,10 +130,7 @@ void rsj::Log(const juce::String& info, const std::source_location& location) no
 void rsj::Log(gsl::czstring<> info, const std::source_location& location) noexcept
 {
    try {
-      if (juce::Logger::getCurrentLogger())
-         juce::Logger::writeToLog(juce::Time::getCurrentTime().toISO8601(true) + ":"
-                                  + location.file_name() + ":" + location.line() + " "
-                                  + juce::String(juce::CharPointer_UTF8(info)));
+      rsj::EnqueueLog(location.file_name(), location.line(), info);
    }
    catch (...) { //-V565
    }
@@ -139,9 +139,9 @@ void rsj::Log(gsl::czstring<> info, const std::source_location& location) noexce
 void rsj::Log(gsl::cwzstring<> info, const std::source_location& location) noexcept
 {
    try {
-      if (juce::Logger::getCurrentLogger())
-         juce::Logger::writeToLog(juce::Time::getCurrentTime().toISO8601(true) + ":"
-                                  + location.file_name() + ":" + location.line() + " " + info);
+      const juce::String text {info};
+      rsj::EnqueueLog(location.file_name(), location.line(),
+          {text.toRawUTF8(), text.getNumBytesAsUTF8()});
    }
    catch (...) { //-V565
    }
@@ -151,13 +151,14 @@ void rsj::LogAndAlertError(
     const juce::String& error_text, const std::source_location& location) noexcept
 {
    try {
+      rsj::WriteLogNow(location.file_name(), location.line(),
+          {error_text.toRawUTF8(), error_text.getNumBytesAsUTF8()});
       {
          juce::MessageManager::callAsync([=] {
             juce::NativeMessageBox::showMessageBox(
                 juce::AlertWindow::WarningIcon, juce::translate("Error"), error_text);
          });
       }
-      rsj::Log(error_text, location);
    }
    catch (...) { //-V565
    }
@@ -167,13 +168,14 @@ void rsj::LogAndAlertError(const juce::String& alert_text, const juce::String& e
     const std::source_location& location) noexcept
 {
    try {
+      rsj::WriteLogNow(location.file_name(), location.line(),
+          {error_text.toRawUTF8(), error_text.getNumBytesAsUTF8()});
       {
          juce::MessageManager::callAsync([=] {
             juce::NativeMessageBox::showMessageBox(
                 juce::AlertWindow::WarningIcon, juce::translate("Error"), alert_text);
          });
       }
-      rsj::Log(error_text, location);
    }
    catch (...) { //-V565
    }
@@ -183,13 +185,13 @@ void rsj::LogAndAlertError(
     gsl::czstring<> error_text, const std::source_location& location) noexcept
 {
    try {
+      rsj::WriteLogNow(location.file_name(), location.line(), error_text);
       {
          juce::MessageManager::callAsync([=] {
             juce::NativeMessageBox::showMessageBox(
                 juce::AlertWindow::WarningIcon, juce::translate("Error"), error_text);
          });
       }
-      rsj::Log(error_text, location);
    }
    catch (...) { //-V565
    }
@@ -208,8 +210,7 @@ void rsj::ExceptionResponse(const std::exception& e, const std::source_location&
 void rsj::Log(const juce::String& info) noexcept
 {
    try {
-      if (juce::Logger::getCurrentLogger())
-         juce::Logger::writeToLog(juce::Time::getCurrentTime().toISO8601(true) + ": " + info);
+      rsj::EnqueueLog(nullptr, 0, {info.toRawUTF8(), info.getNumBytesAsUTF8()});
    }
    catch (...) { //-V565
    }
@@ -218,9 +219,7 @@ void rsj::Log(const juce::String& info) noexcept
 void rsj::Log(gsl::czstring<> info) noexcept
 {
    try {
-      if (juce::Logger::getCurrentLogger())
-         juce::Logger::writeToLog(juce::Time::getCurrentTime().toISO8601(true) + ": "
-                                  + juce::String(juce::CharPointer_UTF8(info)));
+      rsj::EnqueueLog(nullptr, 0, info);
    }
    catch (...) { //-V565
    }
@@ -229,8 +228,8 @@ void rsj::Log(gsl::czstring<> info) noexcept
 void rsj::Log(gsl::cwzstring<> info) noexcept
 {
    try {
-      if (juce::Logger::getCurrentLogger())
-         juce::Logger::writeToLog(juce::Time::getCurrentTime().toISO8601(true) + ": " + info);
+      const juce::String text {info};
+      rsj::EnqueueLog(nullptr, 0, {text.toRawUTF8(), text.getNumBytesAsUTF8()});
    }
    catch (...) { //-V565
    }
@@ -239,13 +238,13 @@ void rsj::Log(gsl::cwzstring<> info) noexcept
 void rsj::LogAndAlertError(const juce::String& error_text) noexcept
 {
    try {
+      rsj::WriteLogNow(nullptr, 0, {error_text.toRawUTF8(), error_text.getNumBytesAsUTF8()});
       {
          juce::MessageManager::callAsync([=] {
             juce::NativeMessageBox::showMessageBox(
                 juce::AlertWindow::WarningIcon, juce::translate("Error"), error_text);
          });
       }
-      rsj::Log(error_text);
    }
    catch (...) { //-V565
    }
@@ -254,13 +253,13 @@ void rsj::LogAndAlertError(const juce::String& error_text) noexcept
 void rsj::LogAndAlertError(const juce::String& alert_text, const juce::String& error_text) noexcept
 {
    try {
+      rsj::WriteLogNow(nullptr, 0, {error_text.toRawUTF8(), error_text.getNumBytesAsUTF8()});
       {
          juce::MessageManager::callAsync([=] {
             juce::NativeMessageBox::showMessageBox(
                 juce::AlertWindow::WarningIcon, juce::translate("Error"), alert_text);
          });
       }
-      rsj::Log(error_text);
    }
    catch (...) { //-V565
    }
@@ -269,13 +268,13 @@ void rsj::LogAndAlertError(const juce::String& alert_text, const juce::String& e
 void rsj::LogAndAlertError(gsl::czstring<> error_text) noexcept
 {
    try {
+      rsj::WriteLogNow(nullptr, 0, error_text);
       {
          juce::MessageManager::callAsync([=] {
             juce::NativeMessageBox::showMessageBox(
                 juce::AlertWindow::WarningIcon, juce::translate("Error"), error_text);
          });
       }
-      rsj::Log(error_text);
    }
    catch (...) { //-V565
    }
@@ -340,4 +339,10 @@ ::std::string rsj::AppLogFilePath(const ::std::string& file_name)
    return rsj::AppLogMac() + "/MIDI2LR/" + file_name;
 }
 
-#endif
\ No newline at end of file
+#endif
+
+juce::File rsj::LogFolderFile(gsl::czstring<> file_name)
+{
+   return juce::FileLogger::getSystemLogFileFolder().getChildFile("MIDI2LR").getChildFile(
+       file_name);
+}
\ No newline at end of file
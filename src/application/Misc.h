@@ -145,6 +145,8 @@ namespace rsj {
    [[nodiscard]] std::string AppDataFilePath(const std::string& file_name);
    [[nodiscard]] std::string AppLogFilePath(const std::string& file_name);
 #endif
+   /* file_name in the folder of the log written by juce::FileLogger::createDefaultAppLogger */
+   [[nodiscard]] juce::File LogFolderFile(gsl::czstring<> file_name);
    /*****************************************************************************/
    /*******************Sleep Timed and Logged************************************/
    /*****************************************************************************/
@@ -117,6 +117,17 @@ PWoptions::PWoptions()
    maxval->setInputFilter(&numrestrict_, false);
    minval->addListener(this);
    maxval->addListener(this);
+   touchlabel_.setFont(Font(15.00f, Font::plain).withTypefaceStyle("Regular"));
+   touchlabel_.setJustificationType(Justification::centredLeft);
+   touchlabel_.setBounds(32, 176, 216, 24);
+   addAndMakeVisible(touchlabel_);
+   touchnote_.setExplicitFocusOrder(3);
+   touchnote_.setMultiLine(false);
+   touchnote_.setReturnKeyStartsNewLine(false);
+   touchnote_.setBounds(32, 208, 150, 24);
+   touchnote_.setInputFilter(&noterestrict_, false);
+   touchnote_.addListener(this);
+   addAndMakeVisible(touchnote_);
    //[/Constructor]
 }
 
@@ -165,6 +176,8 @@ void PWoptions::textEditorFocusLost(TextEditor& t)
       controls_model_->SetPwMin(boundchannel_, val);
    else if (nam == "maxval")
       controls_model_->SetPwMax(boundchannel_, val);
+   else if (nam == "touchnote") /* blank, or a note out of range, clears it */
+      controls_model_->SetTouchNote(boundchannel_, t.isEmpty() ? -1 : val);
 }
 
 void PWoptions::BindToControl(const int channel)
@@ -174,6 +187,9 @@ void PWoptions::BindToControl(const int channel)
        juce::String(controls_model_->GetPwMin(boundchannel_)), juce::dontSendNotification);
    maxval->setText(
        juce::String(controls_model_->GetPwMax(boundchannel_)), juce::dontSendNotification);
+   const auto touch_note {controls_model_->GetTouchNote(boundchannel_)};
+   touchnote_.setText(
+       touch_note < 0 ? juce::String() : juce::String(touch_note), juce::dontSendNotification);
 }
 //[/MiscUserCode]
 
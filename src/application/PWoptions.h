@@ -81,6 +81,9 @@ class PWoptions  : public juce::Component,
 private:
     //[UserVariables]   -- You can add your own custom variables in this section.
    juce::TextEditor::LengthAndCharacterRestriction numrestrict_{5, "0123456789"};
+   juce::TextEditor::LengthAndCharacterRestriction noterestrict_{3, "0123456789"};
+   juce::Label touchlabel_{"touchlabel", juce::translate("Touch note (blank for none)")};
+   juce::TextEditor touchnote_{"touchnote"};
    void textEditorFocusLost(juce::TextEditor& t) override;
    inline static ControlsModel* controls_model_{nullptr};
    int boundchannel_{0}; // note: 0-based
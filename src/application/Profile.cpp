@@ -16,20 +16,146 @@
 #include "Profile.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <exception>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+
+#include <fmt/format.h>
 
 #include "Misc.h"
 
+namespace {
+   /* Binary profile, version 1, in native byte order (all supported platforms are little-endian).
+    * A BinaryHeader is followed by entry_count BinaryEntry sorted by message, string_count
+    * BinaryString, and string_bytes of unterminated UTF-8 text. Entry command and device fields
+    * index the string table. The file is read in place from a memory mapping. */
+   constexpr std::array kBinaryMagic {'M', '2', 'L', 'P'};
+   constexpr uint32_t kBinaryVersion {1};
+   constexpr uint32_t kNoString {0xFFFFFFFF}; /* entry has no device */
+
+   struct BinaryHeader {
+      std::array<char, 4> magic;
+      uint32_t version;
+      uint32_t entry_count;
+      uint32_t string_count;
+      uint32_t string_bytes;
+   };
+
+   struct BinaryEntry {
+      uint8_t channel; /* 1-based */
+      uint8_t type;
+      uint16_t number;
+      uint32_t command;
+      uint32_t device;
+   };
+
+   struct BinaryString {
+      uint32_t offset; /* from start of text */
+      uint32_t length;
+   };
+
+   static_assert(sizeof(BinaryHeader) == 20 && sizeof(BinaryEntry) == 12
+                 && sizeof(BinaryString) == 8 && std::is_trivially_copyable_v<BinaryEntry>,
+       "binary profile records must not contain padding");
+
+   template<class T> T ReadAt(const char* data, const uint64_t offset) noexcept
+   { /* mapped data has no alignment guarantee, so copy rather than cast */
+      T t;
+#pragma warning(suppress : 26481)
+      std::memcpy(&t, data + offset, sizeof t); // NOLINT
+      return t;
+   }
+
+   /* same fields, in the same order of significance, as MidiMessageId's comparison */
+   constexpr uint64_t MessageKey(const rsj::MidiMessageId m) noexcept
+   {
+      return static_cast<uint64_t>(m.channel) << 24 | static_cast<uint64_t>(m.control_number) << 8
+             | static_cast<uint64_t>(m.msg_id_type);
+   }
+
+   constexpr uint64_t SortKey(const Profile::Row& row, const int column) noexcept
+   {
+      /* ties in the command column are broken by message so order doesn't depend on history */
+      if (column == 1)
+         return MessageKey(row.message);
+      return static_cast<uint64_t>(row.command_index) << 32 | MessageKey(row.message);
+   }
+
+   /* contributions of all entries are xor'd together, so the content hash can be updated one entry
+    * at a time and doesn't depend on insertion order */
+   size_t EntryHash(const rsj::MidiMessageId message, const std::string& command) noexcept
+   {
+      const auto h {std::hash<std::string> {}(command)};
+      return h ^ (std::hash<rsj::MidiMessageId> {}(message) + 0x9e3779b9 + (h << 6) + (h >> 2));
+   }
+
+   void EraseMessage(Profile::Contents& contents, const rsj::MidiMessageId message)
+   {
+      if (const auto it {contents.message_map.find(message)}; it != contents.message_map.end()) {
+         contents.content_hash ^= EntryHash(message, it->second);
+         contents.message_map.erase(it);
+      }
+   }
+
+   /* removes only message's entry: other messages may map to the same command */
+   void EraseCommandEntry(
+       Profile::Contents& contents, const std::string& command, const rsj::MidiMessageId message)
+   {
+      const auto [begin, end] {contents.command_string_map.equal_range(command)};
+      if (const auto it {std::find_if(
+              begin, end, [&message](const auto& entry) { return entry.second == message; })};
+          it != end)
+         contents.command_string_map.erase(it);
+   }
+
+   void SetCommand(
+       Profile::Contents& contents, const rsj::MidiMessageId message, const std::string& command)
+   {
+      const auto [it, inserted] {contents.message_map.try_emplace(message, command)};
+      if (!inserted) {
+         contents.content_hash ^= EntryHash(message, it->second);
+         it->second = command;
+      }
+      contents.content_hash ^= EntryHash(message, command);
+   }
+
+   auto RowLess(const std::pair<int, bool> order) noexcept
+   {
+      return [order](const Profile::Row& a, const Profile::Row& b) {
+         if (order.second)
+            return SortKey(a, order.first) < SortKey(b, order.first);
+         return SortKey(b, order.first) < SortKey(a, order.first);
+      };
+   }
+} // namespace
+
 void Profile::AddCommandForMessageI(const size_t command, const rsj::MidiMessageId& message)
 {
    try {
       if (command < command_set_.CommandAbbrevSize()) {
+         auto& contents {MutableI()};
          const auto& cmd_abbreviation {command_set_.CommandAbbrevAt(command)};
-         message_map_[message] = cmd_abbreviation;
-         command_string_map_.emplace(cmd_abbreviation, message);
-         SortI();
-         profile_unsaved_ = true;
+         if (const auto old {contents.message_map.find(message)};
+             old != contents.message_map.end())
+            EraseCommandEntry(contents, old->second, message);
+         SetCommand(contents, message, cmd_abbreviation);
+         contents.command_string_map.emplace(cmd_abbreviation, message);
+         /* if already in the table, the row's sort key changed: move it to its new place */
+         if (const auto row {std::find_if(rows_.begin(), rows_.end(),
+                 [&message](const Row& r) { return r.message == message; })};
+             row != rows_.end()) {
+            rows_.erase(row);
+            InsertRowI({message, command});
+         }
+         ++generation_;
       }
    }
    catch (const std::exception& e) {
@@ -38,22 +164,26 @@ void Profile::AddCommandForMessageI(const size_t command, const rsj::MidiMessage
    }
 }
 
-void Profile::AddRowMapped(const std::string& command, const rsj::MidiMessageId& message)
+void Profile::AddRowMapped(
+    const std::string& command, const rsj::MidiMessageId& message, const rsj::DeviceId device)
 {
    try {
       auto guard {std::unique_lock {mutex_}};
       if (!MessageExistsInMapI(message)) {
-         if (!command_set_.CommandTextIndex(command)) {
-            message_map_[message] = CommandSet::kUnassigned;
-            command_string_map_.emplace(CommandSet::kUnassigned, message);
+         auto& contents {MutableI()};
+         if (device != rsj::kAnyDevice)
+            contents.device_map[message] = device;
+         const auto index {command_set_.CommandTextIndex(command)};
+         if (!index) {
+            SetCommand(contents, message, CommandSet::kUnassigned);
+            contents.command_string_map.emplace(CommandSet::kUnassigned, message);
          }
          else {
-            message_map_[message] = command;
-            command_string_map_.emplace(command, message);
+            SetCommand(contents, message, command);
+            contents.command_string_map.emplace(command, message);
          }
-         command_table_.push_back(message);
-         SortI();
-         profile_unsaved_ = true;
+         InsertRowI({message, index});
+         ++generation_;
       }
    }
    catch (const std::exception& e) {
@@ -62,16 +192,29 @@ void Profile::AddRowMapped(const std::string& command, const rsj::MidiMessageId&
    }
 }
 
-void Profile::AddRowUnmapped(const rsj::MidiMessageId& message)
+bool Profile::AddRowUnmapped(const rsj::MidiMessageId& message, const rsj::DeviceId device)
 {
    try {
+      /* called for every message in learn mode, and nearly always for a known message, so check
+       * without blocking readers first */
+      {
+         auto guard {std::shared_lock {mutex_}};
+         if (MessageExistsInMapI(message) && !OtherDeviceI(message, device))
+            return false;
+      }
       auto guard {std::unique_lock {mutex_}};
-      if (!MessageExistsInMapI(message)) {
-         AddCommandForMessageI(0, message); /* add an entry for 'no command' */
-         command_table_.push_back(message);
-         SortI();
-         profile_unsaved_ = true;
+      if (MessageExistsInMapI(message)) { /* added since the check, or sent by a second device */
+         /* surfaces sending the same message share the row, so feedback goes to every output */
+         if (OtherDeviceI(message, device))
+            MutableI().device_map.erase(message);
+         return false;
       }
+      if (device != rsj::kAnyDevice)
+         MutableI().device_map[message] = device;
+      AddCommandForMessageI(0, message); /* add an entry for 'no command' */
+      InsertRowI({message, 0});
+      ++generation_;
+      return true;
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -79,37 +222,208 @@ void Profile::AddRowUnmapped(const rsj::MidiMessageId& message)
    }
 }
 
-void Profile::FromXml(const juce::XmlElement* root)
+void Profile::Assign(ContentsPtr contents)
 {
-   /* external use only, but will either use external versions of Profile calls to lock individual
-    * accesses or manually lock any internal calls instead of using mutex for entire method */
    try {
-      if (!root || root->getTagName().compare("settings") != 0)
+      Expects(contents);
+      auto guard {std::unique_lock {mutex_}};
+      contents_ = std::move(contents);
+      saved_generation_ = ++generation_;
+      saved_hash_ = contents_->content_hash;
+      /* compiled rows are in default order. Only the row table is copied and sorted: contents_
+       * stays shared with the profile cache */
+      rows_ = contents_->command_table;
+      if (current_sort_ != kDefaultSort)
+         SortI();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void Profile::Builder::Add(
+    const std::string& command, const rsj::MidiMessageId message, const rsj::DeviceId device)
+{
+   try {
+      if (contents_->message_map.find(message) != contents_->message_map.end())
+         return;
+      Add(command_set_.CommandTextIndex(command), message, device);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void Profile::Builder::Add(
+    const size_t command_index, const rsj::MidiMessageId message, const rsj::DeviceId device)
+{
+   try {
+      auto& contents {*contents_};
+      if (contents.message_map.find(message) != contents.message_map.end())
          return;
-      RemoveAllRows();
+      const auto& command {command_set_.CommandAbbrevAt(command_index)};
+      if (device != rsj::kAnyDevice)
+         contents.device_map.emplace(message, device);
+      contents.content_hash ^= EntryHash(message, command);
+      contents.command_string_map.emplace(command, message);
+      contents.message_map.emplace(message, command);
+      contents.command_table.push_back({message, command_index});
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+Profile::ContentsPtr Profile::Builder::Build()
+{
+   try {
+      Expects(contents_); /* only one Build per Builder */
+      Sort(contents_->command_table, kDefaultSort);
+      return std::exchange(contents_, nullptr);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void Profile::Builder::Reserve(const size_t rows)
+{
+   try {
+      contents_->message_map.reserve(rows);
+      contents_->command_table.reserve(rows);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+Profile::ContentsPtr Profile::Compile(const juce::XmlElement* root) const
+{
+   try {
+      if (!root || root->getTagName().compare("settings") != 0)
+         return {};
+      Builder builder {command_set_};
+      builder.Reserve(gsl::narrow_cast<size_t>(root->getNumChildElements()));
       const auto* setting {root->getFirstChildElement()};
       while (setting) {
+         /* profiles saved before devices were recorded have no device attribute: kAnyDevice */
+         const auto device {
+             rsj::DeviceIdForName(setting->getStringAttribute("device").toStdString())};
          if (setting->hasAttribute("controller")) {
             const rsj::MidiMessageId message {setting->getIntAttribute("channel"),
                 setting->getIntAttribute("controller"), rsj::MessageType::kCc};
-            AddRowMapped(setting->getStringAttribute("command_string").toStdString(), message);
+            builder.Add(
+                setting->getStringAttribute("command_string").toStdString(), message, device);
          }
          else if (setting->hasAttribute("note")) {
             const rsj::MidiMessageId note {setting->getIntAttribute("channel"),
                 setting->getIntAttribute("note"), rsj::MessageType::kNoteOn};
-            AddRowMapped(setting->getStringAttribute("command_string").toStdString(), note);
+            builder.Add(setting->getStringAttribute("command_string").toStdString(), note, device);
          }
          else if (setting->hasAttribute("pitchbend")) {
             const rsj::MidiMessageId pb {
                 setting->getIntAttribute("channel"), 0, rsj::MessageType::kPw};
-            AddRowMapped(setting->getStringAttribute("command_string").toStdString(), pb);
+            builder.Add(setting->getStringAttribute("command_string").toStdString(), pb, device);
          }
          setting = setting->getNextElement();
       }
-      auto guard {std::unique_lock {mutex_}};
-      SortI();
-      saved_map_ = message_map_;
-      profile_unsaved_ = false;
+      return builder.Build();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+Profile::ContentsPtr Profile::CompileBinary(const juce::File& binary_file) const
+{
+   try {
+      const juce::MemoryMappedFile mapped {binary_file, juce::MemoryMappedFile::readOnly};
+      const auto* const data {static_cast<const char*>(mapped.getData())};
+      const uint64_t size {mapped.getSize()};
+      if (!data || size < sizeof(BinaryHeader))
+         return {};
+      const auto header {ReadAt<BinaryHeader>(data, 0)};
+      if (header.magic != kBinaryMagic || header.version != kBinaryVersion)
+         return {};
+      const uint64_t entries_at {sizeof(BinaryHeader)};
+      const auto strings_at {entries_at + uint64_t {header.entry_count} * sizeof(BinaryEntry)};
+      const auto text_at {strings_at + uint64_t {header.string_count} * sizeof(BinaryString)};
+      if (text_at + header.string_bytes != size)
+         return {};
+      const auto string_at {[&](const uint32_t index) -> std::optional<std::string_view> {
+         if (index >= header.string_count)
+            return std::nullopt;
+         const auto str {ReadAt<BinaryString>(data, strings_at + index * sizeof(BinaryString))};
+         if (uint64_t {str.offset} + str.length > header.string_bytes)
+            return std::nullopt;
+#pragma warning(suppress : 26481)
+         return std::string_view {data + text_at + str.offset, str.length}; // NOLINT
+      }};
+      /* device names and commands resolved once per string, not once per entry */
+      constexpr rsj::DeviceId kUnresolved {-1};
+      constexpr auto kUnresolvedCommand {std::numeric_limits<size_t>::max()};
+      std::vector<rsj::DeviceId> devices(header.string_count, kUnresolved);
+      std::vector<size_t> commands(header.string_count, kUnresolvedCommand);
+      Builder builder {command_set_};
+      builder.Reserve(header.entry_count);
+      for (uint32_t i {0}; i < header.entry_count; ++i) {
+         const auto entry {ReadAt<BinaryEntry>(data, entries_at + i * sizeof(BinaryEntry))};
+         const auto type {static_cast<rsj::MessageType>(entry.type)};
+         if (entry.channel < 1 || entry.channel > 16
+             || (type != rsj::MessageType::kCc && type != rsj::MessageType::kNoteOn
+                 && type != rsj::MessageType::kPw))
+            return {};
+         if (entry.command >= header.string_count)
+            return {};
+         auto& command {commands.at(entry.command)};
+         if (command == kUnresolvedCommand) {
+            const auto text {string_at(entry.command)};
+            if (!text)
+               return {};
+            command = command_set_.CommandTextIndex(std::string(*text));
+         }
+         auto device {rsj::kAnyDevice};
+         if (entry.device != kNoString) {
+            const auto name {string_at(entry.device)};
+            if (!name)
+               return {};
+            auto& id {devices.at(entry.device)};
+            if (id == kUnresolved)
+               id = rsj::DeviceIdForName(std::string(*name));
+            device = id;
+         }
+         builder.Add(command, {entry.channel, entry.number, type}, device);
+      }
+      return builder.Build();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+juce::File Profile::BinaryFileFor(const juce::File& xml_file)
+{
+   try {
+      return xml_file.withFileExtension(".m2lp");
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
+void Profile::FromXml(const juce::XmlElement* root)
+{
+   try {
+      if (auto contents {Compile(root)})
+         Assign(std::move(contents));
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -122,7 +436,7 @@ std::vector<rsj::MidiMessageId> Profile::GetMessagesForCommand(const std::string
    try {
       auto guard {std::shared_lock {mutex_}};
       std::vector<rsj::MidiMessageId> mm;
-      const auto [begin, end] {command_string_map_.equal_range(command)};
+      const auto [begin, end] {contents_->command_string_map.equal_range(command)};
       std::for_each(begin, end, [&mm](auto&& x) { mm.push_back(x.second); });
       return mm;
    }
@@ -132,15 +446,44 @@ std::vector<rsj::MidiMessageId> Profile::GetMessagesForCommand(const std::string
    }
 }
 
+void Profile::InsertRowI(const Row row)
+{
+   try {
+      rows_.insert(std::upper_bound(rows_.begin(), rows_.end(), row, RowLess(current_sort_)), row);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+Profile::Contents& Profile::MutableI()
+{
+   /* contents_ may also be held by the profile cache or a save in progress. copy before the first
+    * change.
+    * contents_ only goes from shared to unshared on other threads, never the reverse, so a stale
+    * count just costs an extra copy */
+   try {
+      if (contents_.use_count() != 1)
+         contents_ = std::make_shared<Contents>(*contents_);
+      /* every Contents is created non-const, so casting away const is safe once unshared */
+#pragma warning(suppress : 26492)
+      return const_cast<Contents&>(*contents_); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 void Profile::RemoveAllRows()
 {
    try {
       auto guard {std::unique_lock {mutex_}};
-      command_string_map_.clear();
-      command_table_.clear();
-      message_map_.clear();
-      /* no reason for profile_unsaved_ here. nothing to save */
-      profile_unsaved_ = false;
+      contents_ = std::make_shared<Contents>();
+      rows_.clear();
+      /* no reason for unsaved state here. nothing to save */
+      saved_generation_ = ++generation_;
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -153,9 +496,11 @@ void Profile::RemoveMessage(const rsj::MidiMessageId& message)
      assigned */
    try {
       auto guard {std::unique_lock {mutex_}};
-      command_string_map_.erase(message_map_.at(message));
-      message_map_.erase(message);
-      profile_unsaved_ = true;
+      auto& contents {MutableI()};
+      EraseCommandEntry(contents, contents.message_map.at(message), message);
+      contents.device_map.erase(message);
+      EraseMessage(contents, message);
+      ++generation_;
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -168,10 +513,12 @@ void Profile::RemoveRow(const size_t row)
    try {
       auto guard {std::unique_lock {mutex_}};
       const auto msg {GetMessageForNumberI(row)};
-      command_string_map_.erase(message_map_.at(msg));
-      command_table_.erase(command_table_.cbegin() + row);
-      message_map_.erase(msg);
-      profile_unsaved_ = true;
+      auto& contents {MutableI()};
+      EraseCommandEntry(contents, contents.message_map.at(msg), msg);
+      rows_.erase(rows_.cbegin() + row);
+      contents.device_map.erase(msg);
+      EraseMessage(contents, msg);
+      ++generation_;
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -183,18 +530,23 @@ void Profile::RemoveUnassignedMessages()
 {
    try {
       auto guard {std::unique_lock {mutex_}};
-      auto it {command_string_map_.find("Unassigned")};
-      if (it != command_string_map_.end()) {
-         profile_unsaved_ = true;
-         do {
-            message_map_.erase(it->second);
-            command_table_.erase(
-                std::remove(command_table_.begin(), command_table_.end(), it->second),
-                command_table_.end());
-            command_string_map_.erase(it);
-            it = command_string_map_.find("Unassigned");
-         } while (it != command_string_map_.end());
+      /* rows and map entries are removed for the same messages: those mapped to Unassigned */
+      std::unordered_set<rsj::MidiMessageId> unassigned {};
+      for (const auto& [message, command] : contents_->message_map)
+         if (command == CommandSet::kUnassigned)
+            unassigned.insert(message);
+      if (unassigned.empty())
+         return;
+      ++generation_;
+      auto& contents {MutableI()};
+      for (const auto& message : unassigned) {
+         EraseCommandEntry(contents, CommandSet::kUnassigned, message);
+         contents.device_map.erase(message);
+         EraseMessage(contents, message);
       }
+      rows_.erase(std::remove_if(rows_.begin(), rows_.end(),
+                      [&unassigned](const Row& r) { return unassigned.count(r.message) != 0; }),
+          rows_.end());
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -208,6 +560,9 @@ void Profile::Resort(const std::pair<int, bool> new_order)
       auto guard {std::unique_lock {mutex_}};
       current_sort_ = new_order;
       SortI();
+      /* rows move, so displays must refresh. Contents are unchanged, so the hash keeps this from
+       * counting as unsaved */
+      ++generation_;
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -215,24 +570,22 @@ void Profile::Resort(const std::pair<int, bool> new_order)
    }
 }
 
+void Profile::Sort(std::vector<Row>& table, const std::pair<int, bool> order)
+{
+   try {
+      /* keys are precomputed integers, so no command lookups during the sort */
+      std::sort(table.begin(), table.end(), RowLess(order));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
 void Profile::SortI()
 {
    try {
-      const auto msg_idx {[this](const rsj::MidiMessageId a) {
-         return command_set_.CommandTextIndex(GetCommandForMessageI(a));
-      }};
-      const auto msg_sort {[&msg_idx](const rsj::MidiMessageId a, const rsj::MidiMessageId b) {
-         return msg_idx(a) < msg_idx(b);
-      }};
-      if (current_sort_.first == 1)
-         if (current_sort_.second)
-            std::sort(command_table_.begin(), command_table_.end());
-         else
-            std::sort(command_table_.rbegin(), command_table_.rend());
-      else if (current_sort_.second)
-         std::sort(command_table_.begin(), command_table_.end(), msg_sort);
-      else
-         std::sort(command_table_.rbegin(), command_table_.rend(), msg_sort);
+      Sort(rows_, current_sort_);
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -240,15 +593,87 @@ void Profile::SortI()
    }
 }
 
+void Profile::ToBinaryFile(const Contents& contents, const juce::File& file)
+{
+   /* the binary file is only a faster copy of the xml, so failures are logged, not alerted */
+   try {
+      std::vector<BinaryEntry> entries;
+      entries.reserve(contents.message_map.size());
+      std::vector<BinaryString> strings;
+      std::string text;
+      std::unordered_map<std::string, uint32_t> string_index;
+      const auto intern {[&](const std::string& str) {
+         const auto [it, inserted] {
+             string_index.try_emplace(str, gsl::narrow_cast<uint32_t>(strings.size()))};
+         if (inserted) {
+            strings.push_back({gsl::narrow_cast<uint32_t>(text.size()),
+                gsl::narrow_cast<uint32_t>(str.size())});
+            text += str;
+         }
+         return it->second;
+      }};
+      for (const auto& [msg_id, cmd_str] : contents.message_map) {
+         if (msg_id.msg_id_type != rsj::MessageType::kCc
+             && msg_id.msg_id_type != rsj::MessageType::kNoteOn
+             && msg_id.msg_id_type != rsj::MessageType::kPw)
+            continue; /* same types as the xml can hold */
+         const auto dev {contents.device_map.find(msg_id)};
+         entries.push_back({gsl::narrow_cast<uint8_t>(msg_id.channel),
+             static_cast<uint8_t>(msg_id.msg_id_type),
+             gsl::narrow_cast<uint16_t>(msg_id.control_number), intern(cmd_str),
+             dev != contents.device_map.end() ? intern(rsj::DeviceNameForId(dev->second))
+                                              : kNoString});
+      }
+      std::sort(entries.begin(), entries.end(), [](const BinaryEntry& a, const BinaryEntry& b) {
+         return std::tie(a.channel, a.number, a.type) < std::tie(b.channel, b.number, b.type);
+      });
+      const BinaryHeader header {kBinaryMagic, kBinaryVersion,
+          gsl::narrow_cast<uint32_t>(entries.size()), gsl::narrow_cast<uint32_t>(strings.size()),
+          gsl::narrow_cast<uint32_t>(text.size())};
+      /* write beside the target and swap in, so a reader never maps a half-written file */
+      const juce::TemporaryFile temp {file};
+      {
+         juce::FileOutputStream out {temp.getFile()};
+         if (!out.openedOk()) {
+            rsj::Log(fmt::format(FMT_STRING("Unable to write binary profile {}."),
+                file.getFullPathName().toStdString()));
+            return;
+         }
+         out.write(&header, sizeof header);
+         out.write(entries.data(), entries.size() * sizeof(BinaryEntry));
+         out.write(strings.data(), strings.size() * sizeof(BinaryString));
+         out.write(text.data(), text.size());
+         out.flush();
+         if (out.getStatus().failed()) {
+            rsj::Log(fmt::format(FMT_STRING("Unable to write binary profile {}: {}."),
+                file.getFullPathName().toStdString(),
+                out.getStatus().getErrorMessage().toStdString()));
+            return;
+         }
+      }
+      if (!temp.overwriteTargetFileWithTemporary())
+         rsj::Log(fmt::format(FMT_STRING("Unable to replace binary profile {}."),
+             file.getFullPathName().toStdString()));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
+
 void Profile::ToXmlFile(const juce::File& file)
 {
    try {
-      auto guard {std::shared_lock {mutex_}};
+      /* write from a snapshot so that the table isn't locked during the file write */
+      const auto [contents, generation] {[this] {
+         auto guard {std::shared_lock {mutex_}};
+         return std::make_pair(contents_, generation_);
+      }()};
       /* don't bother if map is empty */
-      if (!message_map_.empty()) {
+      if (!contents->message_map.empty()) {
          /* save the contents of the command map to an xml file */
          juce::XmlElement root {"settings"};
-         for (const auto& [msg_id, cmd_str] : message_map_) {
+         for (const auto& [msg_id, cmd_str] : contents->message_map) {
             auto setting {std::make_unique<juce::XmlElement>("setting")};
             setting->setAttribute("channel", msg_id.channel);
             switch (msg_id.msg_id_type) {
@@ -270,6 +695,9 @@ void Profile::ToXmlFile(const juce::File& file)
                continue;
             }
             setting->setAttribute("command_string", cmd_str);
+            if (const auto dev {contents->device_map.find(msg_id)};
+                dev != contents->device_map.end())
+               setting->setAttribute("device", rsj::DeviceNameForId(dev->second));
             root.addChildElement(setting.release());
          }
          if (!root.writeTo(file)) {
@@ -280,12 +708,15 @@ void Profile::ToXmlFile(const juce::File& file)
                     + ' ' + p,
                 "Unable to save file. Choose a different location and try again. " + p);
          }
-         saved_map_ = message_map_;
-         profile_unsaved_ = false;
+         else
+            ToBinaryFile(*contents, BinaryFileFor(file));
+         auto guard {std::unique_lock {mutex_}};
+         saved_generation_ = generation;
+         saved_hash_ = contents->content_hash;
       }
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
       throw;
    }
-}
\ No newline at end of file
+}
@@ -17,7 +17,9 @@
  */
 //-V813_MINSIZE=13 /* warn if passing structure by value > 12 bytes (3*sizeof(int)) */
 
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <shared_mutex>
 #include <string>
 #include <unordered_map>
@@ -35,13 +37,68 @@
  * do have mutex and could be called by another class */
 class Profile {
  public:
-   explicit Profile(const CommandSet& command_set) noexcept : command_set_ {command_set} {}
+   struct Row {
+      rsj::MidiMessageId message {};
+      size_t command_index {0}; /* CommandSet index of the command, kept as the sort key */
+   };
+   /* Fully built profile. Contents are never changed once shared: ProfileManager compiles profiles
+    * ahead of time and hands them over whole, and Profile copies them only when about to modify
+    * them (e.g., in learn mode) */
+   struct Contents {
+      std::multimap<std::string, rsj::MidiMessageId> command_string_map {};
+      /* only messages tied to one controller are present; the rest are kAnyDevice, including
+       * messages more than one controller sends */
+      std::unordered_map<rsj::MidiMessageId, rsj::DeviceId> device_map {};
+      std::unordered_map<rsj::MidiMessageId, std::string> message_map {};
+      /* rows as compiled, in default order. Profile keeps its own table in display order, so
+       * sorting never copies the maps */
+      std::vector<Row> command_table {};
+      size_t content_hash {0}; /* of message_map, maintained as entries change */
+   };
+   using ContentsPtr = std::shared_ptr<const Contents>;
+
+   /* Bulk loader: rows are added without locking or sorting, and sorted once by Build. Duplicate
+    * messages are ignored, first one wins. Not thread-safe, but each thread may use its own */
+   class Builder {
+    public:
+      explicit Builder(const CommandSet& command_set)
+          : command_set_ {command_set}, contents_ {std::make_shared<Contents>()}
+      {
+      }
+      void Add(const std::string& command, rsj::MidiMessageId message,
+          rsj::DeviceId device = rsj::kAnyDevice);
+      /* command_index as returned by CommandSet::CommandTextIndex */
+      void Add(size_t command_index, rsj::MidiMessageId message,
+          rsj::DeviceId device = rsj::kAnyDevice);
+      [[nodiscard]] ContentsPtr Build();
+      void Reserve(size_t rows);
+
+    private:
+      const CommandSet& command_set_;
+      std::shared_ptr<Contents> contents_;
+   };
+
+   explicit Profile(const CommandSet& command_set) : command_set_ {command_set} {}
    void AddCommandForMessage(size_t command, rsj::MidiMessageId message);
-   void AddRowMapped(const std::string& command, const rsj::MidiMessageId& message);
-   void AddRowUnmapped(const rsj::MidiMessageId& message);
+   void AddRowMapped(const std::string& command, const rsj::MidiMessageId& message,
+       rsj::DeviceId device = rsj::kAnyDevice);
+   /* returns true if the row was added, false if the message already had one */
+   bool AddRowUnmapped(const rsj::MidiMessageId& message, rsj::DeviceId device = rsj::kAnyDevice);
+   void Assign(ContentsPtr contents);
+   /* where ToXmlFile puts the binary copy of a profile */
+   [[nodiscard]] static juce::File BinaryFileFor(const juce::File& xml_file);
    [[nodiscard]] bool CommandHasAssociatedMessage(const std::string& command) const;
+   /* Compile and CompileBinary are thread-safe and may be called from any thread. They return an
+    * empty pointer if the input isn't a valid profile */
+   [[nodiscard]] ContentsPtr Compile(const juce::XmlElement* root) const;
+   [[nodiscard]] ContentsPtr CompileBinary(const juce::File& binary_file) const;
    void FromXml(const juce::XmlElement* root);
    [[nodiscard]] const std::string& GetCommandForMessage(rsj::MidiMessageId message) const;
+   /* current contents, safe to read while the profile goes on changing */
+   [[nodiscard]] ContentsPtr GetContents() const;
+   [[nodiscard]] rsj::DeviceId GetDeviceForMessage(rsj::MidiMessageId message) const;
+   /* changes whenever rows, their commands or their order change */
+   [[nodiscard]] uint64_t GetGeneration() const;
    [[nodiscard]] rsj::MidiMessageId GetMessageForNumber(size_t num) const;
    [[nodiscard]] std::vector<rsj::MidiMessageId> GetMessagesForCommand(
        const std::string& command) const;
@@ -57,20 +114,29 @@ class Profile {
    void ToXmlFile(const juce::File& file);
 
  private:
+   static constexpr std::pair<int, bool> kDefaultSort {2, true};
    void AddCommandForMessageI(size_t command, const rsj::MidiMessageId& message);
    const std::string& GetCommandForMessageI(rsj::MidiMessageId message) const;
    rsj::MidiMessageId GetMessageForNumberI(size_t num) const;
+   void InsertRowI(Row row);
    bool MessageExistsInMapI(rsj::MidiMessageId message) const;
+   Contents& MutableI();
+   /* message is tied to a device other than device */
+   bool OtherDeviceI(rsj::MidiMessageId message, rsj::DeviceId device) const;
+   static void Sort(std::vector<Row>& table, std::pair<int, bool> order);
    void SortI();
+   static void ToBinaryFile(const Contents& contents, const juce::File& file);
 
-   bool profile_unsaved_ {false};
    const CommandSet& command_set_;
+   ContentsPtr contents_ {std::make_shared<Contents>()};
    mutable std::shared_mutex mutex_;
-   std::multimap<std::string, rsj::MidiMessageId> command_string_map_ {};
-   std::pair<int, bool> current_sort_ {2, true};
-   std::unordered_map<rsj::MidiMessageId, std::string> message_map_ {};
-   std::unordered_map<rsj::MidiMessageId, std::string> saved_map_ {};
-   std::vector<rsj::MidiMessageId> command_table_ {};
+   /* generation_ counts changes to the mapping. Unsaved means changed since the last load or save,
+    * and not simply changed back (the content hash catches that) */
+   uint64_t generation_ {0};
+   uint64_t saved_generation_ {0};
+   size_t saved_hash_ {0};
+   std::pair<int, bool> current_sort_ {kDefaultSort};
+   std::vector<Row> rows_ {}; /* displayed rows, in current_sort_ order */
 };
 
 inline void Profile::AddCommandForMessage(size_t command, rsj::MidiMessageId message)
@@ -82,7 +148,7 @@ inline void Profile::AddCommandForMessage(size_t command, rsj::MidiMessageId mes
 inline bool Profile::CommandHasAssociatedMessage(const std::string& command) const
 {
    auto guard {std::shared_lock {mutex_}};
-   return command_string_map_.find(command) != command_string_map_.end();
+   return contents_->command_string_map.find(command) != contents_->command_string_map.end();
 }
 
 inline const std::string& Profile::GetCommandForMessage(rsj::MidiMessageId message) const
@@ -91,9 +157,22 @@ inline const std::string& Profile::GetCommandForMessage(rsj::MidiMessageId messa
    return GetCommandForMessageI(message);
 }
 
+inline Profile::ContentsPtr Profile::GetContents() const
+{
+   auto guard {std::shared_lock {mutex_}};
+   return contents_;
+}
+
 inline const std::string& Profile::GetCommandForMessageI(rsj::MidiMessageId message) const
 {
-   return message_map_.at(message);
+   return contents_->message_map.at(message);
+}
+
+inline rsj::DeviceId Profile::GetDeviceForMessage(rsj::MidiMessageId message) const
+{
+   auto guard {std::shared_lock {mutex_}};
+   const auto found {contents_->device_map.find(message)};
+   return found != contents_->device_map.end() ? found->second : rsj::kAnyDevice;
 }
 
 inline rsj::MidiMessageId Profile::GetMessageForNumber(size_t num) const
@@ -104,14 +183,22 @@ inline rsj::MidiMessageId Profile::GetMessageForNumber(size_t num) const
 
 inline rsj::MidiMessageId Profile::GetMessageForNumberI(size_t num) const
 {
-   return command_table_.at(num);
+   return rows_.at(num).message;
 }
 
 inline int Profile::GetRowForMessage(rsj::MidiMessageId message) const
 {
    auto guard {std::shared_lock {mutex_}};
    return gsl::narrow_cast<int>(
-       std::find(command_table_.begin(), command_table_.end(), message) - command_table_.begin());
+       std::find_if(rows_.begin(), rows_.end(),
+           [message](const Row& r) { return r.message == message; })
+       - rows_.begin());
+}
+
+inline uint64_t Profile::GetGeneration() const
+{
+   auto guard {std::shared_lock {mutex_}};
+   return generation_;
 }
 
 inline bool Profile::MessageExistsInMap(rsj::MidiMessageId message) const
@@ -122,19 +209,28 @@ inline bool Profile::MessageExistsInMap(rsj::MidiMessageId message) const
 
 inline bool Profile::MessageExistsInMapI(rsj::MidiMessageId message) const
 {
-   return message_map_.find(message) != message_map_.end();
+   return contents_->message_map.find(message) != contents_->message_map.end();
+}
+
+inline bool Profile::OtherDeviceI(rsj::MidiMessageId message, rsj::DeviceId device) const
+{
+   if (device == rsj::kAnyDevice)
+      return false;
+   const auto found {contents_->device_map.find(message)};
+   return found != contents_->device_map.end() && found->second != device;
 }
 
 inline bool Profile::ProfileUnsaved() const
 {
    auto guard {std::shared_lock {mutex_}};
-   return profile_unsaved_ && !command_table_.empty() && saved_map_ != message_map_;
+   return generation_ != saved_generation_ && !rows_.empty()
+          && saved_hash_ != contents_->content_hash;
 }
 
 inline size_t Profile::Size() const
 {
    auto guard {std::shared_lock {mutex_}};
-   return command_table_.size();
+   return rows_.size();
 }
 
 #endif
@@ -0,0 +1,199 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "ProfileIndexer.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include <fmt/format.h>
+#include <gsl/gsl>
+
+#include "Misc.h"
+
+namespace {
+   [[nodiscard]] uint64_t HashFile(const juce::File& file)
+   { /* FNV-1a. only needs to notice edits, not resist deliberate collisions */
+      const juce::MemoryMappedFile mapped {file, juce::MemoryMappedFile::readOnly};
+      uint64_t hash {0xcbf29ce484222325};
+      if (const auto* const data {static_cast<const unsigned char*>(mapped.getData())}) {
+         const gsl::span<const unsigned char> bytes {data, mapped.getSize()};
+         for (const auto byte : bytes) {
+            hash ^= byte;
+            hash *= 0x100000001b3;
+         }
+      }
+      return hash;
+   }
+} // namespace
+
+ProfileIndexer::~ProfileIndexer()
+{
+   try {
+      Stop();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+   }
+   catch (...) {
+      rsj::LogAndAlertError("Non-standard exception in ~ProfileIndexer.");
+   }
+}
+
+ProfileIndexer::IndexPtr ProfileIndexer::GetIndex() const
+{
+   auto lock {std::scoped_lock(mutex_)};
+   return index_;
+}
+
+void ProfileIndexer::SetDirectory(const juce::File& directory)
+{
+   try {
+      {
+         auto lock {std::scoped_lock(mutex_)};
+         directory_ = directory;
+         directory_changed_ = true;
+      }
+      wake_.notify_one();
+      if (!run_future_.valid()) {
+         run_future_ = std::async(std::launch::async, [this] {
+            rsj::LabelThread(L"ProfileIndexer run thread");
+            MIDI2LR_FAST_FLOATS;
+            Run();
+         });
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ProfileIndexer::Stop()
+{
+   try {
+      {
+         auto lock {std::scoped_lock(mutex_)};
+         stop_ = true;
+      }
+      wake_.notify_one();
+      if (run_future_.valid())
+         run_future_.wait();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ProfileIndexer::Run()
+{
+   try {
+      auto lock {std::unique_lock(mutex_)};
+      do {
+         /* returns at once when the directory was just set */
+         wake_.wait_for(lock, kPollInterval, [this] { return stop_ || directory_changed_; });
+         if (stop_)
+            return;
+         const auto directory {directory_};
+         const auto previous {directory_changed_ ? IndexPtr {} : index_};
+         directory_changed_ = false;
+         lock.unlock();
+         try {
+            Poll(directory, previous);
+         }
+         catch (const std::exception& e) {
+            /* already reported where thrown. keep the thread alive for the next poll */
+            rsj::Log(fmt::format(FMT_STRING("Profile index of {} not updated: {}."),
+                directory.getFullPathName().toStdString(), e.what()));
+         }
+         catch (...) {
+            rsj::Log(fmt::format(FMT_STRING("Profile index of {} not updated: non-standard "
+                                            "exception."),
+                directory.getFullPathName().toStdString()));
+         }
+         lock.lock();
+      } while (true);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ProfileIndexer::Poll(const juce::File& directory, const IndexPtr& previous)
+{
+   try {
+      const auto index {Scan(directory, previous)};
+      {
+         auto lock {std::scoped_lock(mutex_)};
+         /* nothing changed, or result already out of date */
+         if (!index || directory_changed_ || stop_)
+            return;
+         index_ = index;
+      }
+      rsj::Log(fmt::format(FMT_STRING("Indexed {} profiles in {}."), index->entries.size(),
+          directory.getFullPathName().toStdString()));
+      for (const auto& cb : callbacks_)
+#pragma warning(suppress : 26489)
+         /* false warning, checked for existence before adding to callbacks_ */
+         cb(index);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+ProfileIndexer::IndexPtr ProfileIndexer::Scan(
+    const juce::File& directory, const IndexPtr& previous)
+{
+   /* returns empty pointer if nothing changed since previous */
+   try {
+      auto files {directory.findChildFiles(juce::File::findFiles, false, "*.xml")};
+      files.sort();
+      auto index {std::make_shared<Index>()};
+      index->directory = directory;
+      index->entries.reserve(gsl::narrow_cast<size_t>(files.size()));
+      auto changed {!previous || rsj::cmp_not_equal(previous->entries.size(), files.size())};
+      for (const auto& file : files) {
+         Entry entry {file, file.getFileName(), file.getSize(), file.getLastModificationTime()};
+         const Entry* old {nullptr};
+         if (previous) {
+            /* previous entries are sorted the same way as files */
+            const auto& prev {previous->entries};
+            const auto found {std::lower_bound(prev.begin(), prev.end(), file,
+                [](const Entry& e, const juce::File& f) { return e.file < f; })};
+            if (found != prev.end() && found->file == file)
+               old = &*found;
+         }
+         if (old && old->size == entry.size && old->modified == entry.modified)
+            entry.hash = old->hash; /* unchanged, don't read it again */
+         else {
+            entry.hash = HashFile(file);
+            changed = true;
+         }
+         index->entries.push_back(std::move(entry));
+      }
+      if (!changed)
+         return {};
+      return index;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE_F;
+      throw;
+   }
+}
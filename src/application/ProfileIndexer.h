@@ -0,0 +1,87 @@
+#ifndef MIDI2LR_PROFILEINDEXER_H_INCLUDED
+#define MIDI2LR_PROFILEINDEXER_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+#ifndef _MSC_VER
+#define _In_
+#endif
+
+/* Keeps an index of the profiles in the profile directory. A worker thread scans the directory,
+ * then polls it, re-reading only files whose size or modification time changed. Each change is
+ * published as a new immutable Index; callbacks run on the worker thread. A poll that throws is
+ * logged and retried at the next interval. */
+class ProfileIndexer final {
+ public:
+   struct Entry {
+      juce::File file;
+      juce::String name; /* file name, as listed to the user and sent by the plugin */
+      juce::int64 size {0};
+      juce::Time modified;
+      uint64_t hash {0}; /* of the file's contents */
+   };
+   struct Index {
+      juce::File directory;
+      std::vector<Entry> entries; /* sorted by file */
+   };
+   using IndexPtr = std::shared_ptr<const Index>;
+
+   ProfileIndexer() = default;
+   ~ProfileIndexer();
+   ProfileIndexer(const ProfileIndexer& other) = delete;
+   ProfileIndexer(ProfileIndexer&& other) = delete;
+   ProfileIndexer& operator=(const ProfileIndexer& other) = delete;
+   ProfileIndexer& operator=(ProfileIndexer&& other) = delete;
+   template<class T>
+   void AddCallback(_In_ T* const object, _In_ void (T::*const mf)(const IndexPtr&))
+   {
+      using namespace std::placeholders;
+      if (object && mf)
+         /* only store non-empty functions */
+         callbacks_.emplace_back(std::bind(mf, object, _1));
+   }
+   [[nodiscard]] IndexPtr GetIndex() const;
+   /* starts the worker on first use; a new directory is scanned from scratch */
+   void SetDirectory(const juce::File& directory);
+   void Stop();
+
+ private:
+   static constexpr auto kPollInterval {std::chrono::seconds(2)};
+   void Poll(const juce::File& directory, const IndexPtr& previous);
+   void Run();
+   [[nodiscard]] static IndexPtr Scan(const juce::File& directory, const IndexPtr& previous);
+
+   bool directory_changed_ {false};
+   bool stop_ {false};
+   IndexPtr index_ {};
+   juce::File directory_ {};
+   mutable std::mutex mutex_; /* guards all of the above */
+   std::condition_variable wake_;
+   std::future<void> run_future_;
+   std::vector<std::function<void(const IndexPtr&)>> callbacks_;
+};
+
+#endif
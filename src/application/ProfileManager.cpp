@@ -15,6 +15,7 @@
  */
 #include "ProfileManager.h"
 
+#include <algorithm>
 #include <exception>
 #include <string>
 
@@ -35,19 +36,77 @@ ProfileManager::ProfileManager(
    /* add ourselves as a listener to LR_IPC_OUT so that we can send plugin settings on connection */
    midi_receiver.AddCallback(this, &ProfileManager::MidiCmdCallback);
    lr_ipc_out_.AddCallback(this, &ProfileManager::ConnectionCallback);
+   indexer_.AddCallback(this, &ProfileManager::IndexChanged);
+}
+
+ProfileManager::~ProfileManager()
+{
+   try {
+      stopping_.store(true, std::memory_order_release);
+      indexer_.Stop();
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+   }
+   catch (...) {
+      rsj::LogAndAlertError("Non-standard exception in ~ProfileManager.");
+   }
 }
 
 void ProfileManager::SetProfileDirectory(const juce::File& directory)
 {
    try {
+      /* listing happens on the indexer thread; the first profile is selected once the index
+       * arrives, unless a profile is chosen by name before then */
       profile_location_ = directory;
-      auto file_array {directory.findChildFiles(juce::File::findFiles, false, "*.xml")};
-      file_array.sort();
       profiles_.clear();
-      for (const auto& file : file_array) profiles_.emplace_back(file.getFileName());
-      if (!profiles_.empty())
-         SwitchToProfile(profiles_[0]);
       current_profile_index_ = 0;
+      switch_to_first_.store(true, std::memory_order_release);
+      indexer_.SetDirectory(directory);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+Profile::ContentsPtr ProfileManager::GetCompiled(
+    const juce::File& profile_file, const ProfileIndexer::Entry* indexed)
+{
+   try {
+      const auto path {profile_file.getFullPathName()};
+      const auto modified {profile_file.getLastModificationTime()};
+      /* the indexed hash only describes the file if it hasn't been touched since the scan */
+      const auto hash {indexed && indexed->modified == modified ? indexed->hash : 0};
+      {
+         auto lock {std::scoped_lock(cache_mutex_)};
+         if (const auto found {cache_.find(path)}; found != cache_.end()) {
+            auto& cached {found->second};
+            if (cached.modified == modified)
+               return cached.contents;
+            if (hash && cached.hash == hash) {
+               /* saved again without edits, or only touched */
+               cached.modified = modified;
+               return cached.contents;
+            }
+         }
+      }
+      /* not yet compiled, or changed on disk since. compile outside the lock; if the indexer
+       * thread gets to the same file first the second result simply replaces the first. the
+       * binary copy written on save is used unless the xml has been edited since */
+      Profile::ContentsPtr contents {};
+      if (const auto binary {Profile::BinaryFileFor(profile_file)};
+          binary.existsAsFile() && binary.getLastModificationTime() >= modified)
+         contents = current_profile_.CompileBinary(binary);
+      if (!contents) {
+         if (const auto parsed {juce::parseXML(profile_file)})
+            contents = current_profile_.Compile(parsed.get());
+      }
+      if (contents) {
+         auto lock {std::scoped_lock(cache_mutex_)};
+         cache_.insert_or_assign(path, CachedProfile {modified, hash, contents});
+      }
+      return contents;
    }
    catch (const std::exception& e) {
       MIDI2LR_E_RESPONSE;
@@ -57,6 +116,60 @@ void ProfileManager::SetProfileDirectory(const juce::File& directory)
 
 const std::vector<juce::String>& ProfileManager::GetMenuItems() const noexcept { return profiles_; }
 
+void ProfileManager::ApplyIndex(const ProfileIndexer::IndexPtr& index)
+{
+   try {
+      /* stays on the same profile if it's still there */
+      const auto current {current_profile_index_ >= 0
+                                  && rsj::cmp_less(current_profile_index_, profiles_.size())
+                              ? profiles_.at(gsl::narrow_cast<size_t>(current_profile_index_))
+                              : juce::String {}};
+      profiles_.clear();
+      profiles_.reserve(index->entries.size());
+      for (const auto& entry : index->entries) profiles_.push_back(entry.name);
+      const auto found {std::find(profiles_.begin(), profiles_.end(), current)};
+      current_profile_index_ =
+          found != profiles_.end() ? gsl::narrow_cast<int>(found - profiles_.begin()) : 0;
+      applied_index_ = index;
+      if (switch_to_first_.exchange(false, std::memory_order_acq_rel) && !profiles_.empty())
+         SwitchToProfile(0);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void ProfileManager::IndexChanged(const ProfileIndexer::IndexPtr& index)
+{
+   /* runs on the indexer thread. let the message thread update the list first, then compile new
+    * and changed profiles here so that switching to them doesn't have to */
+   try {
+      triggerAsyncUpdate();
+      {
+         auto lock {std::scoped_lock(cache_mutex_)};
+         for (auto it {cache_.begin()}; it != cache_.end();) {
+            if (std::none_of(index->entries.begin(), index->entries.end(),
+                    [&it](const ProfileIndexer::Entry& e) {
+                       return e.file.getFullPathName() == it->first;
+                    }))
+               it = cache_.erase(it);
+            else
+               ++it;
+         }
+      }
+      for (const auto& entry : index->entries) {
+         if (stopping_.load(std::memory_order_acquire))
+            return;
+         [[maybe_unused]] const auto contents {GetCompiled(entry.file, &entry)};
+      }
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
 void ProfileManager::SwitchToProfile(int profile_index)
 {
    try {
@@ -74,10 +187,11 @@ void ProfileManager::SwitchToProfile(int profile_index)
 void ProfileManager::SwitchToProfile(const juce::String& profile)
 {
    try {
+      switch_to_first_.store(false, std::memory_order_release);
       const auto profile_file {profile_location_.getChildFile(profile)};
       if (profile_file.exists()) {
-         if (const auto parsed {juce::parseXML(profile_file)}) {
-            for (const auto& cb : callbacks_) cb(parsed.get(), profile);
+         if (const auto contents {GetCompiled(profile_file)}) {
+            for (const auto& cb : callbacks_) cb(contents, profile);
             lr_ipc_out_.SendCommand(fmt::format(FMT_STRING("ChangedToDirectory {}\n"),
                 juce::File::addTrailingSeparator(profile_location_.getFullPathName())
                     .toStdString()));
@@ -121,7 +235,12 @@ void ProfileManager::SwitchToPreviousProfile()
 void ProfileManager::MapCommand(const rsj::MidiMessageId& msg)
 {
    try {
-      const auto cmd {current_profile_.GetCommandForMessage(msg)};
+      /* holding the contents keeps cmd valid without copying it */
+      const auto contents {current_profile_.GetContents()};
+      const auto found {contents->message_map.find(msg)};
+      if (found == contents->message_map.end())
+         return;
+      const auto& cmd {found->second};
       if (cmd == "PrevPro") {
          switch_state_ = SwitchState::kPrev;
          triggerAsyncUpdate();
@@ -172,6 +291,9 @@ void ProfileManager::ConnectionCallback(const bool connected, const bool blocked
 void ProfileManager::handleAsyncUpdate()
 {
    try {
+      if (const auto index {indexer_.GetIndex()};
+          index && index != applied_index_ && index->directory == profile_location_)
+         ApplyIndex(index);
       switch (switch_state_) {
       case SwitchState::kPrev:
          SwitchToPreviousProfile();
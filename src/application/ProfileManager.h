@@ -15,12 +15,18 @@
  * see <http://www.gnu.org/licenses/>.
  *
  */
+#include <atomic>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <vector>
 
 #include <juce_core/juce_core.h>
 #include <juce_events/juce_events.h>
 
+#include "Profile.h"
+#include "ProfileIndexer.h"
+
 #ifndef _MSC_VER
 #define _In_
 #endif
@@ -28,7 +34,6 @@
 class ControlsModel;
 class LrIpcOut;
 class MidiReceiver;
-class Profile;
 namespace rsj {
    struct MidiMessage;
    struct MidiMessageId;
@@ -38,14 +43,14 @@ class ProfileManager final : juce::AsyncUpdater {
  public:
    ProfileManager(
        ControlsModel& c_model, const Profile& profile, LrIpcOut& out, MidiReceiver& midi_receiver);
-   ~ProfileManager() = default; // NOLINT(modernize-use-override)
+   ~ProfileManager(); // NOLINT(modernize-use-override)
    ProfileManager(const ProfileManager& other) = delete;
    ProfileManager(ProfileManager&& other) = delete;
    ProfileManager& operator=(const ProfileManager& other) = delete;
    ProfileManager& operator=(ProfileManager&& other) = delete;
    template<class T>
-   void AddCallback(
-       _In_ T* const object, _In_ void (T::*const mf)(juce::XmlElement*, const juce::String&))
+   void AddCallback(_In_ T* const object,
+       _In_ void (T::*const mf)(const Profile::ContentsPtr&, const juce::String&))
    {
       using namespace std::placeholders;
       if (object && mf)
@@ -61,9 +66,14 @@ class ProfileManager final : juce::AsyncUpdater {
    void SwitchToProfile(const juce::String& profile);
 
  private:
+   void ApplyIndex(const ProfileIndexer::IndexPtr& index);
+   /* indexed, when given, lets a file whose contents hash is unchanged skip recompiling */
+   [[nodiscard]] Profile::ContentsPtr GetCompiled(
+       const juce::File& profile_file, const ProfileIndexer::Entry* indexed = nullptr);
    [[nodiscard]] const std::vector<juce::String>& GetMenuItems() const noexcept;
    void ConnectionCallback(bool, bool);
    void handleAsyncUpdate() override;
+   void IndexChanged(const ProfileIndexer::IndexPtr& index);
    void MapCommand(const rsj::MidiMessageId& msg);
    void MidiCmdCallback(const rsj::MidiMessage&);
    void SwitchToNextProfile();
@@ -75,14 +85,27 @@ class ProfileManager final : juce::AsyncUpdater {
       kNext,
    };
 
+   struct CachedProfile {
+      juce::Time modified;
+      uint64_t hash {0}; /* ProfileIndexer::Entry::hash of the compiled file, 0 if unknown */
+      Profile::ContentsPtr contents;
+   };
+
    const Profile& current_profile_;
    ControlsModel& controls_model_;
    int current_profile_index_ {0};
    juce::File profile_location_;
    LrIpcOut& lr_ipc_out_;
    std::vector<juce::String> profiles_;
-   std::vector<std::function<void(juce::XmlElement*, const juce::String&)>> callbacks_;
+   std::vector<std::function<void(const Profile::ContentsPtr&, const juce::String&)>> callbacks_;
+   std::atomic<bool> stopping_ {false};
+   std::atomic<bool> switch_to_first_ {false};
+   ProfileIndexer::IndexPtr applied_index_ {}; /* message thread only */
+   /* compiled profiles keyed by full path, shared with the indexer thread */
+   std::map<juce::String, CachedProfile> cache_;
+   std::mutex cache_mutex_;
    SwitchState switch_state_ {SwitchState::kNone};
+   ProfileIndexer indexer_; /* last, so it stops before the members its callback uses go away */
 };
 
 #endif
@@ -0,0 +1,126 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "SessionRecording.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+
+#include <fmt/format.h>
+
+#include "Misc.h"
+
+namespace {
+   constexpr auto kMagic {"M2LRSES1"};
+   constexpr size_t kMagicSize {8};
+   constexpr char kDeviceRecord {'D'};
+   constexpr char kMessageRecord {'M'};
+} // namespace
+
+SessionWriter::SessionWriter(const juce::File& file)
+{
+   try {
+      file.deleteFile();
+      stream_ = file.createOutputStream(16 * 1024);
+      if (Ok())
+         stream_->write(kMagic, kMagicSize);
+      else
+         rsj::Log(fmt::format(
+             FMT_STRING("Unable to record MIDI to {}."), file.getFullPathName().toStdString()));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void SessionWriter::Write(const rsj::MidiMessage& mm)
+{
+   try {
+      if (!Ok())
+         return;
+      if (devices_written_.insert(mm.device).second) {
+         stream_->writeByte(kDeviceRecord);
+         stream_->writeShort(gsl::narrow_cast<short>(mm.device));
+         stream_->writeString(rsj::DeviceNameForId(mm.device));
+      }
+      const auto gap {count_ == 0 ? 0.0 : std::max(0.0, mm.timestamp - last_timestamp_)};
+      last_timestamp_ = mm.timestamp;
+      ++count_;
+      stream_->writeByte(kMessageRecord);
+      stream_->writeInt(gsl::narrow_cast<int>(static_cast<juce::uint32>(std::min(gap * 1.0e6,
+          static_cast<double>(std::numeric_limits<juce::uint32>::max())))));
+      stream_->writeByte(static_cast<char>(mm.message_type_byte));
+      stream_->writeByte(gsl::narrow_cast<char>(mm.channel));
+      stream_->writeShort(gsl::narrow_cast<short>(mm.control_number));
+      stream_->writeShort(gsl::narrow_cast<short>(mm.value));
+      stream_->writeShort(gsl::narrow_cast<short>(mm.device));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+SessionReader::SessionReader(const juce::File& file) : stream_ {file}
+{
+   try {
+      char magic[kMagicSize] {};
+      ok_ = stream_.openedOk() && stream_.read(magic, kMagicSize) == kMagicSize
+            && std::equal(magic, magic + kMagicSize, kMagic);
+      if (!ok_)
+         rsj::Log(fmt::format(FMT_STRING("{} is not a MIDI2LR session recording."),
+             file.getFullPathName().toStdString()));
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+std::optional<SessionReader::Entry> SessionReader::Next()
+{
+   try {
+      while (ok_ && !stream_.isExhausted()) {
+         const auto kind {stream_.readByte()};
+         if (kind == kDeviceRecord) {
+            const int file_id {stream_.readShort()};
+            devices_[file_id] = rsj::DeviceIdForName(stream_.readString().toStdString());
+            continue;
+         }
+         if (kind != kMessageRecord)
+            break;
+         Entry entry {};
+         entry.delay = static_cast<juce::uint32>(stream_.readInt()) / 1.0e6;
+         const auto type {static_cast<juce::uint8>(stream_.readByte())};
+         entry.message.channel = stream_.readByte();
+         entry.message.control_number = stream_.readShort();
+         entry.message.value = stream_.readShort();
+         const auto device {devices_.find(stream_.readShort())};
+         if (type < 0x8 || type > 0xF || device == devices_.end())
+            break;
+         entry.message.message_type_byte = static_cast<rsj::MessageType>(type);
+         entry.message.device = device->second;
+         return entry;
+      }
+      ok_ = false;
+      return std::nullopt;
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
@@ -0,0 +1,75 @@
+#ifndef MIDI2LR_SESSIONRECORDING_H_INCLUDED
+#define MIDI2LR_SESSIONRECORDING_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+
+#include <juce_core/juce_core.h>
+
+#include "MidiUtilities.h"
+
+/* A session recording is the message stream MidiReceiver dispatches, after NRPN assembly, with
+ * the gap before each message and the name of the device it came from. Layout, little-endian:
+ *   header   "M2LRSES1"
+ *   device   'D' int16 id, UTF-8 name, nul. Precedes the first message from that device.
+ *   message  'M' uint32 microseconds since the previous message, uint8 type, uint8 channel,
+ *            int16 control number, int16 value, int16 device id
+ * Device ids are only meaningful within the file; names are mapped back on replay. */
+class SessionWriter {
+ public:
+   explicit SessionWriter(const juce::File& file);
+   ~SessionWriter() = default;
+   SessionWriter(const SessionWriter& other) = delete;
+   SessionWriter(SessionWriter&& other) = delete;
+   SessionWriter& operator=(const SessionWriter& other) = delete;
+   SessionWriter& operator=(SessionWriter&& other) = delete;
+   [[nodiscard]] bool Ok() const noexcept { return stream_ && stream_->openedOk(); }
+   void Write(const rsj::MidiMessage& mm);
+   [[nodiscard]] juce::int64 Count() const noexcept { return count_; }
+
+ private:
+   std::unique_ptr<juce::FileOutputStream> stream_;
+   std::set<rsj::DeviceId> devices_written_ {};
+   double last_timestamp_ {0.0};
+   juce::int64 count_ {0};
+};
+
+class SessionReader {
+ public:
+   struct Entry {
+      rsj::MidiMessage message;
+      double delay {0.0}; /* seconds since the previous message */
+   };
+   explicit SessionReader(const juce::File& file);
+   ~SessionReader() = default;
+   SessionReader(const SessionReader& other) = delete;
+   SessionReader(SessionReader&& other) = delete;
+   SessionReader& operator=(const SessionReader& other) = delete;
+   SessionReader& operator=(SessionReader&& other) = delete;
+   [[nodiscard]] bool Ok() const noexcept { return ok_; }
+   /* nullopt at the end of the file or at the first malformed record */
+   [[nodiscard]] std::optional<Entry> Next();
+
+ private:
+   juce::FileInputStream stream_;
+   std::map<int, rsj::DeviceId> devices_ {}; /* file id to this session's id */
+   bool ok_ {false};
+};
+
+#endif
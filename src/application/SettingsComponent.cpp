@@ -20,17 +20,20 @@
 
 #include <fmt/format.h>
 
+#include "FlightRecorder.h"
+#include "MIDIReceiver.h"
 #include "Misc.h"
 #include "SettingsManager.h"
 
 namespace {
    constexpr auto kSettingsLeft {20};
    constexpr auto kSettingsWidth {400};
-   constexpr auto kSettingsHeight {300};
+   constexpr auto kSettingsHeight {460};
+   constexpr auto kHalfButtonWidth {(kSettingsWidth - 2 * kSettingsLeft - 10) / 2};
 } // namespace
 
-SettingsComponent::SettingsComponent(SettingsManager& settings_manager)
-    : ResizableLayout {this}, settings_manager_ {settings_manager}
+SettingsComponent::SettingsComponent(SettingsManager& settings_manager, MidiReceiver& midi_receiver)
+    : ResizableLayout {this}, midi_receiver_ {midi_receiver}, settings_manager_ {settings_manager}
 {
 }
 
@@ -125,6 +128,67 @@ void SettingsComponent::Init()
          rsj::Log(fmt::format(
              FMT_STRING("Autohide time set to {} seconds."), settings_manager_.GetAutoHideTime()));
       };
+
+      /* motorized faders */
+      echo_group_.setText(juce::translate("Motorized faders"));
+      echo_group_.setBounds(0, 300, kSettingsWidth, 100);
+      addToLayout(&echo_group_, anchorMidLeft, anchorMidRight);
+      addAndMakeVisible(echo_group_);
+
+      echo_explain_label_.setFont(juce::Font {16.f, juce::Font::bold});
+      echo_explain_label_.setText(juce::translate("Ignore faders repeating the value just sent "
+                                                  "to them for x ms, select 0 for disabling"),
+          juce::NotificationType::dontSendNotification);
+      echo_explain_label_.setBounds(kSettingsLeft, 315, kSettingsWidth - 2 * kSettingsLeft, 50);
+      addToLayout(&echo_explain_label_, anchorMidLeft, anchorMidRight);
+      echo_explain_label_.setEditable(false);
+      echo_explain_label_.setColour(juce::Label::textColourId, juce::Colours::darkgrey);
+      addAndMakeVisible(echo_explain_label_);
+
+      echo_setting_.setBounds(kSettingsLeft, 345, kSettingsWidth - 2 * kSettingsLeft, 50);
+      echo_setting_.setRange(0, 1000, 10);
+      echo_setting_.setValue(
+          settings_manager_.GetEchoWindow(), juce::NotificationType::dontSendNotification);
+      addToLayout(&echo_setting_, anchorMidLeft, anchorMidRight);
+      addAndMakeVisible(echo_setting_);
+      echo_setting_.onValueChange = [this] {
+         settings_manager_.SetEchoWindow(std::lrint(echo_setting_.getValue()));
+         rsj::Log(fmt::format(
+             FMT_STRING("Echo window set to {} ms."), settings_manager_.GetEchoWindow()));
+      };
+
+      /* diagnostics */
+      diagnostics_group_.setText(juce::translate("Diagnostics"));
+      diagnostics_group_.setBounds(0, 400, kSettingsWidth, 60);
+      addToLayout(&diagnostics_group_, anchorMidLeft, anchorMidRight);
+      addAndMakeVisible(diagnostics_group_);
+
+      trace_button_.setBounds(kSettingsLeft, 420, kHalfButtonWidth, 25);
+      addToLayout(&trace_button_, anchorMidLeft, anchorMidCenter);
+      addAndMakeVisible(trace_button_);
+      trace_button_.onClick = [] {
+         if (const auto file {rsj::DefaultTraceFile()}; rsj::DumpTrace(file))
+            file.revealToUser();
+      };
+
+      record_button_.setButtonText(midi_receiver_.IsRecording()
+                                       ? juce::translate("Stop Recording MIDI")
+                                       : juce::translate("Record MIDI Session"));
+      record_button_.setBounds(kSettingsWidth - kSettingsLeft - kHalfButtonWidth, 420,
+          kHalfButtonWidth, 25);
+      addToLayout(&record_button_, anchorMidCenter, anchorMidRight);
+      addAndMakeVisible(record_button_);
+      record_button_.onClick = [this] {
+         /* next to the log, for attaching to a bug report */
+         const auto file {rsj::LogFolderFile("MIDI2LR_session.m2lrses")};
+         if (midi_receiver_.IsRecording()) {
+            midi_receiver_.StopRecording();
+            record_button_.setButtonText(juce::translate("Record MIDI Session"));
+            file.revealToUser();
+         }
+         else if (midi_receiver_.StartRecording(file))
+            record_button_.setButtonText(juce::translate("Stop Recording MIDI"));
+      };
       /* turn it on */
       activateLayout();
    }
@@ -21,11 +21,12 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 
 #include "falco/ResizableLayout.h"
+class MidiReceiver;
 class SettingsManager;
 
 class SettingsComponent final : public juce::Component, ResizableLayout {
  public:
-   explicit SettingsComponent(SettingsManager& settings_manager);
+   SettingsComponent(SettingsManager& settings_manager, MidiReceiver& midi_receiver);
    ~SettingsComponent() = default; // NOLINT(modernize-use-override)
    SettingsComponent(const SettingsComponent& other) = delete;
    SettingsComponent(SettingsComponent&& other) = delete;
@@ -37,14 +38,21 @@ class SettingsComponent final : public juce::Component, ResizableLayout {
    void paint(juce::Graphics&) override;
 
    juce::GroupComponent autohide_group_ {};
+   juce::GroupComponent diagnostics_group_ {};
+   juce::GroupComponent echo_group_ {};
    juce::GroupComponent pickup_group_ {};
    juce::GroupComponent profile_group_ {};
    juce::Label autohide_explain_label_ {};
+   juce::Label echo_explain_label_ {};
    juce::Label pickup_label_ {"PickupLabel", ""};
    juce::Label profile_location_label_ {"Profile Label"};
    juce::Slider autohide_setting_;
+   juce::Slider echo_setting_;
    juce::TextButton profile_location_button_ {juce::translate("Choose Profile Folder")};
+   juce::TextButton record_button_ {};
+   juce::TextButton trace_button_ {juce::translate("Save Pipeline Trace")};
    juce::ToggleButton pickup_enabled_ {juce::translate("Enable Pickup Mode")};
+   MidiReceiver& midi_receiver_;
    SettingsManager& settings_manager_;
 };
 
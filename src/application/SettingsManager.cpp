@@ -32,6 +32,8 @@ SettingsManager::SettingsManager(ProfileManager& profile_manager, LrIpcOut& lr_i
       file_options.osxLibrarySubFolder = "Application Support/MIDI2LR";
       file_options.storageFormat = juce::PropertiesFile::storeAsXML;
       properties_file_ = std::make_unique<juce::PropertiesFile>(file_options);
+      lr_ipc_out_.SetPickupEnabled(GetPickupEnabled());
+      lr_ipc_out_.SetEchoWindow(GetEchoWindow());
       /* add a listener to LR_IPC_OUT so that we can send plugin settings on connection */
       lr_ipc_out_.AddCallback(this, &SettingsManager::ConnectionCallback);
       profile_manager_.SetProfileDirectory(GetProfileDirectory());
@@ -51,14 +53,9 @@ void SettingsManager::ConnectionCallback(const bool connected, const bool blocke
 {
    try {
       if (connected && !blocked) {
-         if (GetPickupEnabled()) {
-            lr_ipc_out_.SendCommand("Pickup 1\n");
-            rsj::Log("Pickup is enabled.");
-         }
-         else {
-            lr_ipc_out_.SendCommand("Pickup 0\n");
-            rsj::Log("Pickup is disabled.");
-         }
+         /* the app applies pickup itself, so the plugin always passes values straight through */
+         lr_ipc_out_.SendCommand("Pickup 0\n");
+         rsj::Log(GetPickupEnabled() ? "Pickup is enabled." : "Pickup is disabled.");
          static std::once_flag of; /* add debug info once to logs */
          std::call_once(of, [this] {
             const DebugInfo db {GetProfileDirectory()};
@@ -37,6 +37,10 @@ class SettingsManager final {
    {
       return properties_file_->getIntValue("autohide", 0);
    }
+   [[nodiscard]] int GetEchoWindow() const noexcept
+   {
+      return properties_file_->getIntValue("echo_window", 250);
+   }
    [[nodiscard]] juce::String GetDefaultProfile() const noexcept
    {
       return properties_file_->getValue("default_profile");
@@ -59,6 +63,11 @@ class SettingsManager final {
    {
       properties_file_->setValue("default_profile", default_profile);
    }
+   void SetEchoWindow(int window_ms)
+   {
+      properties_file_->setValue("echo_window", window_ms);
+      lr_ipc_out_.SetEchoWindow(window_ms);
+   }
    void SetLastVersionFound(int version_number)
    {
       properties_file_->setValue("LastVersionFound", version_number);
@@ -66,7 +75,7 @@ class SettingsManager final {
    void SetPickupEnabled(bool enabled)
    {
       properties_file_->setValue("pickup_enabled", enabled);
-      lr_ipc_out_.SendCommand(fmt::format(FMT_STRING("Pickup {}\n"), enabled ? '1' : '0'));
+      lr_ipc_out_.SetPickupEnabled(enabled);
    }
    void SetProfileDirectory(const juce::String& profile_directory)
    {
@@ -0,0 +1,82 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "StatsComponent.h"
+
+#include <exception>
+
+#include "AllocationAccounting.h"
+#include "Metrics.h"
+#include "Misc.h"
+
+namespace {
+   constexpr auto kStatsWidth {520};
+   constexpr auto kStatsHeight {360};
+   constexpr auto kStatsMargin {10};
+} // namespace
+
+void StatsComponent::Init()
+{
+   try {
+      setSize(kStatsWidth, kStatsHeight);
+      stats_text_.setMultiLine(true, false);
+      stats_text_.setReadOnly(true);
+      stats_text_.setCaretVisible(false);
+      stats_text_.setFont(juce::Font {juce::Font::getDefaultMonospacedFontName(), 13.f,
+          juce::Font::plain});
+      stats_text_.setBounds(kStatsMargin, kStatsMargin, kStatsWidth - 2 * kStatsMargin,
+          kStatsHeight - 2 * kStatsMargin);
+      addToLayout(&stats_text_, anchorTopLeft, anchorBottomRight);
+      addAndMakeVisible(stats_text_);
+      timerCallback();
+      /* turn it on */
+      activateLayout();
+      startTimer(1000);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void StatsComponent::paint(juce::Graphics& g)
+{ //-V2009 overridden method
+   try {
+      g.fillAll(juce::Colours::white); /* clear the background */
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
+
+void StatsComponent::timerCallback()
+{
+   try {
+      juce::String text {};
+      for (const auto& line : rsj::Metrics().ReportLines())
+         text << juce::String::fromUTF8(line.data(), gsl::narrow_cast<int>(line.size()))
+              << juce::newLine;
+      if constexpr (rsj::kAllocAccounting)
+         for (const auto& line : rsj::AllocationReport())
+            text << juce::String::fromUTF8(line.data(), gsl::narrow_cast<int>(line.size()))
+                 << juce::newLine;
+      stats_text_.setText(text, false);
+   }
+   catch (const std::exception& e) {
+      MIDI2LR_E_RESPONSE;
+      throw;
+   }
+}
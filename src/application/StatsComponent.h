@@ -0,0 +1,42 @@
+#ifndef MIDI2LR_STATSCOMPONENT_H_INCLUDED
+#define MIDI2LR_STATSCOMPONENT_H_INCLUDED
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <juce_events/juce_events.h>
+#include <juce_graphics/juce_graphics.h>
+#include <juce_gui_basics/juce_gui_basics.h>
+
+#include "falco/ResizableLayout.h"
+
+/* live view of rsj::Metrics(), refreshed once a second */
+class StatsComponent final : public juce::Component, juce::Timer, ResizableLayout {
+ public:
+   StatsComponent() : ResizableLayout {this} {}
+   ~StatsComponent() = default; // NOLINT(modernize-use-override)
+   StatsComponent(const StatsComponent& other) = delete;
+   StatsComponent(StatsComponent&& other) = delete;
+   StatsComponent& operator=(const StatsComponent& other) = delete;
+   StatsComponent& operator=(StatsComponent&& other) = delete;
+   void Init();
+
+ private:
+   void paint(juce::Graphics&) override;
+   void timerCallback() override;
+
+   juce::TextEditor stats_text_ {};
+};
+
+#endif
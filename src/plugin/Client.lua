@@ -558,7 +558,18 @@ LrTasks.startAsyncTask(
           UpdateParam = UpdateParamNoPickup
         end
       end,
+      PickupFailed       = function(value) -- app held back a control short of Lightroom's value
+        if not ProgramPreferences.ClientShowBezelOnChange then return end
+        local param, midi_value = value:match('(%S+)%s+(%S+)')
+        midi_value = tonumber(midi_value)
+        if not (param and midi_value and Database.Parameters[param]) then return end
+        if LrApplicationView.getCurrentModuleName() ~= 'develop' then return end
+        if LrApplication.activeCatalog():getTargetPhoto() == nil then return end
+        local actualvalue = LrDevelopController.getValue(param)
+        CU.showBezel(param,CU.MIDIValueToLRValue(param,midi_value),actualvalue)
+      end,
       ProfileAmount     = CU.ProfileAmount,
+      RefreshParams     = CU.RefreshParams,
       --[[
       For SetRating, if send back sync value to controller, formula is:
       (Rating * 2 + 1)/12
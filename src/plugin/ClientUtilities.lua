@@ -535,6 +535,24 @@ local function FullRefresh()
   end
 end
 
+local function RefreshParams(params)
+  -- the app asks only for the parameters it has no current value for
+  if Limits.LimitsCanBeSet() then
+    for param in params:gmatch('%S+') do
+      if Database.Parameters[param] then -- buttons and actions have no value to send
+        if param:sub(1,4) == 'Crop' then -- crop values depend on each other
+          FullRefresh()
+          return
+        end
+        local lrvalue = LrDevelopController.getValue(param)
+        if type(lrvalue) == 'number' then
+          MIDI2LR.SERVER:send(string.format('%s %g\n', param, LRValueToMIDIValue(param)))
+        end
+      end
+    end
+  end
+end
+
 local function fSimulateKeys(keys, developonly, tool)
   return function()
     if developonly then
@@ -840,6 +858,7 @@ return {
   ProfileAmount = ProfileAmount,
   QuickCropAspect = QuickCropAspect,
   RatioCrop = RatioCrop,
+  RefreshParams = RefreshParams,
   RemoveFilters = RemoveFilters,
   ResetAllGrayMixer = ResetAllGrayMixer,
   ResetAllHueAdjustment = ResetAllHueAdjustment,
@@ -0,0 +1,18 @@
+#!/bin/bash
+# Runs MIDI2LR's allocation check: faders.m2lrses replayed twice against LrSim, with faders.xml as
+# the profile. Exits with MIDI2LR's result, 0 if nothing in the checked scopes allocated the second
+# time. MIDI2LR must be built with MIDI2LR_ALLOC_ACCOUNTING defined.
+# usage: alloc_check.sh <path to MIDI2LR executable>
+set -u
+here="$(cd "$(dirname "$0")" && pwd)"
+midi2lr="${1:?usage: alloc_check.sh <path to MIDI2LR executable>}"
+"$here/../lrsim/compile.sh" || exit 2
+"$here/../lrsim/LrSim" --duration-s 120 &
+lrsim=$!
+sleep 1
+"$midi2lr" --profile "$here/faders.xml" --replay "$here/faders.m2lrses" --speed 1 --alloc-check
+result=$?
+kill "$lrsim" 2>/dev/null
+wait "$lrsim" 2>/dev/null
+echo "MIDI2LR allocation check exit code $result"
+exit $result
@@ -0,0 +1,371 @@
+/*
+ * This file is part of MIDI2LR. Copyright (C) 2015 by Rory Jaffe.
+ *
+ * MIDI2LR is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * MIDI2LR is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+ * the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with MIDI2LR.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+/* Stand-in for the Lightroom side of MIDI2LR's two loopback sockets, for load and soak testing
+ * without Lightroom. Listens where the plugin does: commands from the app arrive on 58763 and
+ * values go back on 58764. Each incoming line is processed after a configurable delay and
+ * jitter, as though Lightroom were busy. FullRefresh and RefreshParams are answered with
+ * parameter values, and parameter changes are echoed back the way the plugin's observer does.
+ * Scripted lines (SwitchProfile, SendKey, anything else) are sent at fixed times. Every report
+ * interval it prints throughput and backlog.
+ *
+ * usage: LrSim [--delay-ms n] [--jitter-ms n] [--params n] [--no-echo] [--script file]
+ *              [--report-s n] [--duration-s n]
+ * script lines: <ms after start> <line to send>, e.g. "5000 SwitchProfile Portrait.xml" */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <asio.hpp>
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+   constexpr unsigned short kReceivePort {58763}; /* app's LrIpcOut connects here */
+   constexpr unsigned short kSendPort {58764};    /* app's LrIpcIn connects here */
+   constexpr std::array kDevelopParams {"Exposure", "Contrast", "Highlights", "Shadows", "Whites",
+       "Blacks", "Texture", "Clarity", "Dehaze", "Vibrance", "Saturation", "Temperature", "Tint",
+       "ParametricDarks", "ParametricLights", "ParametricShadows", "ParametricHighlights",
+       "ParametricShadowSplit", "ParametricMidtoneSplit", "ParametricHighlightSplit",
+       "SaturationAdjustmentRed", "SaturationAdjustmentOrange", "SaturationAdjustmentYellow",
+       "SaturationAdjustmentGreen", "SaturationAdjustmentAqua", "SaturationAdjustmentBlue",
+       "SaturationAdjustmentPurple", "SaturationAdjustmentMagenta", "HueAdjustmentRed",
+       "HueAdjustmentOrange", "HueAdjustmentYellow", "HueAdjustmentGreen", "HueAdjustmentAqua",
+       "HueAdjustmentBlue", "HueAdjustmentPurple", "HueAdjustmentMagenta",
+       "LuminanceAdjustmentRed", "LuminanceAdjustmentOrange", "LuminanceAdjustmentYellow",
+       "LuminanceAdjustmentGreen", "LuminanceAdjustmentAqua", "LuminanceAdjustmentBlue",
+       "LuminanceAdjustmentPurple", "LuminanceAdjustmentMagenta", "SplitToningShadowHue",
+       "SplitToningShadowSaturation", "SplitToningHighlightHue", "SplitToningHighlightSaturation",
+       "SplitToningBalance", "ColorGradeBlending", "ColorGradeMidtoneHue", "ColorGradeMidtoneSat",
+       "ColorGradeMidtoneLum", "Sharpness", "SharpenRadius", "SharpenDetail", "SharpenEdgeMasking",
+       "LuminanceSmoothing", "LuminanceNoiseReductionDetail", "LuminanceNoiseReductionContrast",
+       "ColorNoiseReduction", "ColorNoiseReductionDetail", "ColorNoiseReductionSmoothness",
+       "PostCropVignetteAmount", "PostCropVignetteMidpoint", "PostCropVignetteFeather",
+       "PostCropVignetteRoundness", "PostCropVignetteHighlightContrast", "GrainAmount",
+       "GrainSize", "GrainFrequency", "CropTop", "CropBottom", "CropLeft", "CropRight",
+       "CropAngle", "PerspectiveVertical", "PerspectiveHorizontal", "PerspectiveRotate",
+       "PerspectiveScale", "PerspectiveAspect", "PerspectiveX", "PerspectiveY"};
+
+   struct Options {
+      int delay_ms {0};
+      int jitter_ms {0};
+      size_t params {300};
+      bool echo {true};
+      std::string script {};
+      int report_s {1};
+      int duration_s {0}; /* 0: until killed */
+   };
+
+   struct ScriptLine {
+      std::chrono::milliseconds at;
+      std::string line;
+   };
+
+   class Simulator {
+    public:
+      explicit Simulator(const Options& options) : options_ {options}
+      {
+         std::mt19937 values_rng {1}; /* same starting values every run */
+         std::uniform_real_distribution<double> unit {0.0, 1.0};
+         for (size_t i {0}; i < std::max(options_.params, kDevelopParams.size()); ++i) {
+            auto name {i < kDevelopParams.size() ? std::string(kDevelopParams.at(i))
+                                                 : "SimParam" + std::to_string(i)};
+            values_.emplace(name, unit(values_rng));
+            order_.push_back(std::move(name));
+         }
+         order_.resize(options_.params);
+      }
+
+      void Run(const std::vector<ScriptLine>& script)
+      {
+         std::thread receiver {[this] { Receive(); }};
+         std::thread sender {[this] { AcceptSender(); }};
+         std::thread processor {[this] { Process(); }};
+         std::thread scripted {[this, &script] { PlayScript(script); }};
+         const auto start {Clock::now()};
+         auto last_report {start};
+         while (options_.duration_s <= 0
+                || Clock::now() - start < std::chrono::seconds(options_.duration_s)) {
+            std::this_thread::sleep_for(std::chrono::seconds(options_.report_s));
+            const auto now {Clock::now()};
+            Report(std::chrono::duration<double>(now - last_report).count());
+            last_report = now;
+         }
+         std::cout << "Totals: received " << total_received_ << ", processed " << total_processed_
+                   << ", sent " << total_sent_ << ", max backlog " << max_backlog_ << std::endl;
+         std::_Exit(0); /* blocking accepts and reads don't need an orderly shutdown */
+      }
+
+    private:
+      void Receive()
+      {
+         asio::ip::tcp::acceptor acceptor {
+             io_context_, {asio::ip::address_v4::loopback(), kReceivePort}};
+         for (;;) {
+            asio::ip::tcp::socket socket {io_context_};
+            acceptor.accept(socket);
+            std::cout << "App connected on " << kReceivePort << std::endl;
+            asio::streambuf buffer {};
+            asio::error_code ec {};
+            for (;;) {
+               const auto bytes {asio::read_until(socket, buffer, '\n', ec)};
+               if (ec)
+                  break;
+               std::string line {asio::buffers_begin(buffer.data()),
+                   asio::buffers_begin(buffer.data()) + bytes - 1};
+               buffer.consume(bytes);
+               {
+                  std::scoped_lock lock {queue_mutex_};
+                  queue_.push_back(std::move(line));
+                  max_backlog_ = std::max(max_backlog_, queue_.size());
+               }
+               received_.fetch_add(1, std::memory_order_relaxed);
+               queue_condition_.notify_one();
+            }
+            std::cout << "App disconnected from " << kReceivePort << ": " << ec.message()
+                      << std::endl;
+         }
+      }
+
+      void AcceptSender()
+      {
+         asio::ip::tcp::acceptor acceptor {
+             io_context_, {asio::ip::address_v4::loopback(), kSendPort}};
+         for (;;) {
+            auto socket {std::make_unique<asio::ip::tcp::socket>(io_context_)};
+            acceptor.accept(*socket);
+            std::cout << "App connected on " << kSendPort << std::endl;
+            {
+               std::scoped_lock lock {send_mutex_};
+               send_socket_ = std::move(socket);
+            }
+            std::unique_lock lock {send_mutex_};
+            send_condition_.wait(lock, [this] { return !send_socket_; });
+         }
+      }
+
+      void Send(const std::string& lines, size_t count)
+      {
+         std::scoped_lock lock {send_mutex_};
+         if (!send_socket_)
+            return; /* app not listening; Lightroom drops these too */
+         asio::error_code ec {};
+         asio::write(*send_socket_, asio::buffer(lines), ec);
+         if (ec) {
+            std::cout << "App disconnected from " << kSendPort << ": " << ec.message()
+                      << std::endl;
+            send_socket_.reset();
+            send_condition_.notify_all();
+            return;
+         }
+         sent_.fetch_add(count, std::memory_order_relaxed);
+      }
+
+      void Process()
+      {
+         std::mt19937 jitter_rng {std::random_device {}()};
+         std::uniform_int_distribution<int> jitter {-options_.jitter_ms, options_.jitter_ms};
+         for (;;) {
+            std::string line {};
+            {
+               std::unique_lock lock {queue_mutex_};
+               queue_condition_.wait(lock, [this] { return !queue_.empty(); });
+               line = std::move(queue_.front());
+               queue_.pop_front();
+            }
+            if (const auto delay {options_.delay_ms + jitter(jitter_rng)}; delay > 0)
+               std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            Handle(line);
+            processed_.fetch_add(1, std::memory_order_relaxed);
+         }
+      }
+
+      void Handle(const std::string& line)
+      {
+         const auto space {line.find(' ')};
+         const auto command {line.substr(0, space)};
+         const auto argument {space == std::string::npos ? std::string() : line.substr(space + 1)};
+         if (command == "FullRefresh") {
+            SendValues(order_);
+            return;
+         }
+         if (command == "RefreshParams") {
+            std::istringstream names {argument};
+            std::vector<std::string> requested {};
+            for (std::string name; names >> name;) requested.push_back(std::move(name));
+            SendValues(requested);
+            return;
+         }
+         const auto found {values_.find(command)};
+         if (found == values_.end())
+            return; /* AppInfo, Pickup and other commands the simulator has no state for */
+         char* end {nullptr};
+         const auto value {std::strtod(argument.c_str(), &end)};
+         if (end == argument.c_str())
+            return;
+         found->second = std::clamp(value, 0.0, 1.0);
+         if (options_.echo)
+            Send(FormatValue(found->first, found->second), 1);
+      }
+
+      void SendValues(const std::vector<std::string>& names)
+      {
+         std::string burst {};
+         size_t count {0};
+         for (const auto& name : names)
+            if (const auto found {values_.find(name)}; found != values_.end()) {
+               burst += FormatValue(found->first, found->second);
+               ++count;
+            }
+         Send(burst, count);
+      }
+
+      static std::string FormatValue(const std::string& name, double value)
+      {
+         std::array<char, 32> number {};
+         std::snprintf(number.data(), number.size(), "%g", value);
+         return name + ' ' + number.data() + '\n';
+      }
+
+      void PlayScript(const std::vector<ScriptLine>& script)
+      {
+         const auto start {Clock::now()};
+         for (const auto& entry : script) {
+            std::this_thread::sleep_until(start + entry.at);
+            Send(entry.line + '\n', 1);
+            std::cout << "Sent scripted line: " << entry.line << std::endl;
+         }
+      }
+
+      void Report(double seconds)
+      {
+         const auto received {received_.exchange(0, std::memory_order_relaxed)};
+         const auto processed {processed_.exchange(0, std::memory_order_relaxed)};
+         const auto sent {sent_.exchange(0, std::memory_order_relaxed)};
+         total_received_ += received;
+         total_processed_ += processed;
+         total_sent_ += sent;
+         size_t backlog {0};
+         {
+            std::scoped_lock lock {queue_mutex_};
+            backlog = queue_.size();
+         }
+         std::cout << "in " << received / seconds << "/s, processed " << processed / seconds
+                   << "/s, out " << sent / seconds << "/s, backlog " << backlog << std::endl;
+      }
+
+      const Options options_;
+      asio::io_context io_context_ {};
+      std::unordered_map<std::string, double> values_ {}; /* processor thread only */
+      std::vector<std::string> order_ {};                  /* FullRefresh order */
+      std::mutex queue_mutex_;
+      std::condition_variable queue_condition_;
+      std::deque<std::string> queue_ {};
+      size_t max_backlog_ {0}; /* guarded by queue_mutex_ */
+      std::mutex send_mutex_;
+      std::condition_variable send_condition_;
+      std::unique_ptr<asio::ip::tcp::socket> send_socket_ {};
+      std::atomic<std::uint64_t> received_ {0};
+      std::atomic<std::uint64_t> processed_ {0};
+      std::atomic<std::uint64_t> sent_ {0};
+      std::uint64_t total_received_ {0};
+      std::uint64_t total_processed_ {0};
+      std::uint64_t total_sent_ {0};
+   };
+
+   std::vector<ScriptLine> LoadScript(const std::string& path)
+   {
+      std::vector<ScriptLine> script {};
+      if (path.empty())
+         return script;
+      std::ifstream in {path};
+      if (!in)
+         throw std::runtime_error("Unable to open script " + path);
+      for (std::string text; std::getline(in, text);) {
+         std::istringstream fields {text};
+         long long at_ms {0};
+         std::string line {};
+         if (!(fields >> at_ms) || !std::getline(fields >> std::ws, line) || line.empty())
+            continue; /* blank or comment */
+         script.push_back({std::chrono::milliseconds(at_ms), std::move(line)});
+      }
+      std::stable_sort(script.begin(), script.end(),
+          [](const ScriptLine& a, const ScriptLine& b) { return a.at < b.at; });
+      return script;
+   }
+
+   Options ParseOptions(int argc, char* argv[])
+   {
+      Options options {};
+      const std::vector<std::string_view> args(argv + 1, argv + argc);
+      for (size_t i {0}; i < args.size(); ++i) {
+         const auto next {[&]() -> std::string {
+            if (i + 1 >= args.size())
+               throw std::runtime_error("Missing value for " + std::string(args[i]));
+            return std::string(args[++i]);
+         }};
+         if (args[i] == "--delay-ms")
+            options.delay_ms = std::stoi(next());
+         else if (args[i] == "--jitter-ms")
+            options.jitter_ms = std::stoi(next());
+         else if (args[i] == "--params")
+            options.params = std::stoul(next());
+         else if (args[i] == "--no-echo")
+            options.echo = false;
+         else if (args[i] == "--script")
+            options.script = next();
+         else if (args[i] == "--report-s")
+            options.report_s = std::max(1, std::stoi(next()));
+         else if (args[i] == "--duration-s")
+            options.duration_s = std::stoi(next());
+         else
+            throw std::runtime_error("Unknown option " + std::string(args[i]));
+      }
+      options.jitter_ms = std::min(std::abs(options.jitter_ms), options.delay_ms);
+      return options;
+   }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+   try {
+      const auto options {ParseOptions(argc, argv)};
+      Simulator simulator {options};
+      simulator.Run(LoadScript(options.script));
+   }
+   catch (const std::exception& e) {
+      std::cerr << "LrSim: " << e.what() << std::endl;
+      return 1;
+   }
+}
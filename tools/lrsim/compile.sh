@@ -0,0 +1,4 @@
+#!/bin/bash
+# Builds LrSim next to this script. Uses the asio headers bundled with MIDI2LR.
+cd "$(dirname "$0")"
+${CXX:-c++} -std=c++17 -O2 -I../../external/asio LrSim.cpp -o LrSim -pthread